@@ -1,69 +1,742 @@
+// madvise and the other POSIX/BSD calls are hidden by -std=c11 otherwise
+#define _DEFAULT_SOURCE
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include <time.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <limits.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#if defined(__unix__) || defined(__APPLE__)
+#define HAVE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#define HAVE_X86_SIMD 1
+#endif
 
 // Include the structures and functions from main2.c
 // (Copying relevant parts for testing)
 
-// Node structure
-typedef struct Node {
+// Node structure for parse tree
+typedef struct Node
+{
     char value;
+    char arenaOwned;      // 1 when the node lives in a NodeArena
+    char childrenInArena; // 1 when the children array lives in a NodeArena
+    int numChildren;      // Operand count of an n-ary AND/OR node, 0 otherwise
     struct Node *left;
     struct Node *right;
+    union
+    {
+        struct Node **children; // Operands of an n-ary node (left and right are unused)
+        int var;                // Symbol ID of a variable leaf
+    };
 } Node;
 
-// Other structures...
-typedef struct {
-    char variable;
-    int value;
+// Structure to store truth values
+typedef struct
+{
+    int variable; // Symbol ID
+    int value;    // 0 for false, 1 for true
 } TruthAssignment;
 
-typedef struct {
-    int *literals;
-    int size;
+// Structure for DIMACS clauses
+typedef struct
+{
+    int *literals; // Array of literals (positive or negative integers)
+    int size;      // Number of literals in clause
 } Clause;
 
-typedef struct {
-    Clause *clauses;
+// Structure for DIMACS CNF formula
+typedef struct
+{
+    Clause *clauses;     // Clause list layout only
+    int *literals;       // When set, one block holding every clause's literals
+    size_t *clauseStart; // Flat layouts: numClauses + 1 offsets into literals
+    int layout;          // DIMACS_CLAUSE_LIST, DIMACS_FLAT or DIMACS_FLAT_PACKED
     int numClauses;
     int numVars;
 } DIMACSFormula;
 
-typedef struct {
-    char charVar;
-    int intVar;
+// Interned variable names. Every distinct name gets a dense ID starting
+// at 1. Names are copied into chunks that never move, and IDs map to them
+// through fixed blocks, so a name pointer stays valid while other threads
+// intern. Lookups read the current slot table without the lock; only a
+// name that is missing takes it.
+#define SYMBOL_BLOCK_BITS 12                      // Names per ID block: 4096
+#define SYMBOL_BLOCKS (1 << 16)                   // Room for 2^28 IDs
+#define SYMBOL_CHUNK_BYTES 65536                  // Usual size of a name chunk
+
+// Open addressing on the name hash, 0 = empty. Replaced, never resized in
+// place, so a reader always sees a whole table.
+typedef struct
+{
+    int capacity; // Power of two
+    int ids[];
+} SymbolSlots;
+
+typedef struct
+{
+    const char **blocks[SYMBOL_BLOCKS]; // ID -> name, SYMBOL_BLOCK_BITS at a time
+    int count;                          // IDs 1..count are in use
+    SymbolSlots *slots;                 // Current table
+    char *chunk;                        // Chunk that new names are copied into
+    long chunkUsed;
+    long chunkSize;
+    void **retired;                     // Old chunks and slot tables, freed with the table
+    int numRetired;
+    int retiredCapacity;
+} SymbolTable;
+
+// DIMACS numbering of the variables of one formula (symbol ID <-> int)
+typedef struct
+{
+    int *intOfSymbol;   // Symbol ID -> DIMACS variable, 0 when not numbered
+    int symbolCapacity;
+    int *symbolOfInt;   // DIMACS variable -> symbol ID
+    int intCapacity;
+    int size;           // DIMACS variables 1..size are in use
+    int firstAux;       // First auxiliary (Tseitin) variable, 0 when none
 } VarMapping;
 
-VarMapping varMap[100];
-int varMapSize = 0;
+// Token produced by the lexer. Operators and parentheses use their own
+// character as the type, variables use 'v' and the end of input uses '\0'.
+typedef struct
+{
+    char type;
+    char value; // First character of the variable name when type == 'v'
+    int pos;    // Offset of the token in the source formula
+    int var;    // Symbol ID when type == 'v'
+} Token;
+
+// Parse error with the offset of the offending character
+typedef struct
+{
+    int position; // -1 when there is no error
+    const char *message;
+} ParseError;
+
+// Parser state. Every parse owns one, so independent formulas can be
+// parsed concurrently on different threads.
+typedef struct
+{
+    const char *source; // Formula being parsed
+    Token *tokens;      // Tokens of an infix formula (NULL for prefix input)
+    int pos;            // Cursor: token index for infix, char index for prefix
+    ParseError error;   // First error encountered
+} ParserState;
+
+// Work shared by the batch parsing threads
+typedef struct
+{
+    char **formulas;
+    Node **results;
+    ParseError *errors;
+    int count;
+    int nextIndex; // Next formula to hand out (updated atomically)
+} ParseBatch;
+
+// Frame of the explicit stack used by the iterative tree walks
+typedef struct
+{
+    Node *node;  // Node being visited (partial result for the parser)
+    Node **slot; // Where a rewritten subtree is stored
+    int state;   // Walk-specific progress marker
+    int value;   // Walk-specific value (depth, operand result, operator)
+} WalkFrame;
+
+// Growable stack of walk frames, kept per thread and reused across calls
+typedef struct
+{
+    WalkFrame *frames;
+    int top;
+    int capacity;
+} WorkStack;
+
+// Block of nodes handed out by a NodeArena
+typedef struct ArenaBlock
+{
+    struct ArenaBlock *next;
+    int used;
+    int capacity;
+    Node nodes[];
+} ArenaBlock;
+
+// Bump allocator for parse-tree nodes. All nodes of a tree (or of a whole
+// pipeline) are released together by resetArena or destroyArena.
+typedef struct
+{
+    ArenaBlock *first;   // Oldest block, kept across resets
+    ArenaBlock *current; // Block nodes are currently taken from
+    long nodeCount;      // Nodes handed out since the last reset
+} NodeArena;
+
+// Node allocation counters (per thread)
+typedef struct
+{
+    long allocations; // Calls to malloc for nodes or arena blocks
+    long frees;
+    long currentBytes;
+    long peakBytes;
+} NodeStats;
+
+// Unique table of hash-consed nodes: structurally equal subformulas are
+// stored once, so a formula becomes a DAG and copies are pointer reuse
+typedef struct
+{
+    Node **slots;     // Open addressing, capacity is a power of two
+    int capacity;
+    int count;
+    NodeArena *arena; // Owns every shared node
+    long lookups;
+    long hits;
+} HashConsTable;
+
+// Memoized result of a DAG computation on one node (or pair of nodes)
+typedef struct
+{
+    Node *key;
+    Node *other;   // Second operand for pairwise computations
+    int tag;       // Which computation the entry belongs to
+    Node *result;
+    double count;  // Expanded tree size, for sharing reports
+} MemoEntry;
+
+typedef struct
+{
+    MemoEntry *entries;
+    int capacity;
+    int count;
+} MemoTable;
+
+// Frame of the explicit stack used by the DAG computations. Results are
+// passed between frames on a separate value stack.
+typedef struct
+{
+    Node *a;
+    Node *b;
+    int task;
+    int phase;
+    int flag;
+} DagFrame;
+
+typedef struct
+{
+    DagFrame *frames;
+    int top;
+    int capacity;
+    Node **values;
+    int valueTop;
+    int valueCapacity;
+} DagStack;
+
+// Tree stored as parallel arrays in pre-order: node 0 is the root and every
+// child has a larger index than its parent
+typedef struct
+{
+    int count;
+    int capacity;
+    char *ops;        // Operator or variable of each node
+    uint32_t *left;   // Child indices, FLAT_NONE when absent
+    uint32_t *right;
+    int *vars;        // Symbol ID of each variable leaf
+    uint8_t *links;   // 1 for the extra entries chaining an n-ary node; they sit at its depth
+    uint32_t *scratch; // Reused work space (2 * capacity entries)
+} FlatTree;
+
+#define FLAT_NONE 0xFFFFFFFFu
+
+// Formula compiled to postfix instructions for a stack machine. Variables
+// are resolved to dense slots, so evaluation needs no name lookups.
+typedef struct
+{
+    uint32_t *code;   // Opcode in the low byte, operand in the upper 24 bits
+    int length;
+    int capacity;
+    int *slotVars;    // Symbol ID of each variable slot
+    int numSlots;
+    int maxStack;     // Deepest stack the program reaches
+    unsigned char *stack;
+    uint64_t *wordStack; // Stack for 64 rows at a time
+} Program;
+
+// Bytecode opcodes
+#define OP_LOAD 0    // Push the value of slot operand
+#define OP_NOT 1
+#define OP_OR 2
+#define OP_AND 3
+#define OP_IMPLIES 4
+
+// Aggregate results of a truth table
+typedef struct
+{
+    long long satisfying; // Rows where the formula is true
+    long long firstModel; // Lowest satisfying row, -1 if none
+    long long lastModel;  // Highest satisfying row, -1 if none
+} TruthTableSummary;
+
+// Called for every row, in row order, while a table is enumerated
+typedef void (*TruthRowSink)(void *context, long long row, int result);
+
+// Work shared by the truth-table threads
+typedef struct
+{
+    Program *program;
+    uint64_t *table;
+    int level;                // SIMD level every thread uses
+    long long rows;
+    long long words;
+    long long numChunks;
+    long long nextChunk;      // Next chunk to hand out (updated atomically)
+    unsigned char *chunkDone; // Chunks already written, when streaming rows
+    pthread_mutex_t lock;
+    pthread_cond_t chunkReady;
+} TruthTableJob;
+
+// One truth-table thread and the totals of the chunks it evaluated
+typedef struct
+{
+    TruthTableJob *job;
+    TruthTableSummary summary;
+} TruthTableWorker;
+
+// Tree copied into arrays for Gray-code enumeration. Every node caches its
+// value, so flipping one variable only recomputes the paths above its leaves.
+// Nodes are numbered in pre-order: the root is 0 and children follow parents.
+typedef struct
+{
+    int numNodes;
+    char *op;           // Operator, or 0 for a variable leaf
+    int *parent;        // Parent node, -1 for the root
+    int *childStart;    // Children of i: children[childStart[i] .. childStart[i + 1])
+    int *children;
+    int *trueChildren;  // Children currently true (used by '+' and '*')
+    unsigned char *value;
+    int *slotVars;      // Symbol ID of each variable slot (collectVariables order)
+    int numSlots;
+    int *leafStart;     // Leaves of slot s: leaves[leafStart[s] .. leafStart[s + 1])
+    int *leaves;
+    long long updates;  // Node values recomputed so far
+} IncrementalCircuit;
+
+// One operand while a program is being cofactored
+typedef struct
+{
+    int constant; // 0 or 1 once folded to a constant, -1 when it has code
+    int start;    // Where its code starts in the result
+} CofactorEntry;
+
+// What the cofactor-splitting generator did for one table
+typedef struct
+{
+    long long constantBlocks; // Blocks of rows filled with one value
+    long long constantRows;   // Rows covered by those blocks
+    long long evaluatedRows;  // Rows left to the SIMD kernels
+} CofactorStats;
+
+#define TABLE_MAX_SINKS 4
+
+// Buffered truth-table text going to several files at once. Each row is
+// formatted once into the buffer, which is written to every file when full.
+typedef struct
+{
+    FILE *files[TABLE_MAX_SINKS];
+    int numFiles;
+    int varCount;   // Columns of the rows being written
+    char *buffer;
+    size_t used;
+    size_t capacity;
+} TableWriter;
+
+// Fixed header of a binary truth table (.ttb). It is followed by numVars
+// NUL-terminated names, then at dataOffset by one bit per row: row r is
+// bit r % 8 of byte r / 8. Fields are little-endian on every host.
+typedef struct
+{
+    char magic[4];       // "TTB1"
+    uint32_t numVars;
+    uint64_t numRows;
+    uint64_t dataOffset; // Start of the row bits, a multiple of 8
+} TruthTableFileHeader;
+
+// A whole file's bytes: mapped where the platform has mmap, read into a
+// buffer otherwise
+typedef struct
+{
+    const char *data;
+    size_t size;
+    bool mapped;
+} FileView;
+
+// Binary truth table mapped into memory
+typedef struct
+{
+    FileView view;
+    TruthTableFileHeader header; // Fields in host byte order
+    const unsigned char *bits;
+    const char **varNames; // Points into the mapping
+} TruthTableFile;
+
+// Clauses of one subformula while clauseSetToDIMACS works on it. Each clause
+// is sorted by literalKey without repeats, so two clauses merge in one pass.
+// No clause is a tautology, a duplicate or (after reduceClauseSet) a
+// superset of another.
+typedef struct
+{
+    int *literals;       // Clause i is literals[start[i] .. start[i + 1])
+    int *start;          // numClauses + 1 entries
+    uint64_t *hash;      // Hash of each clause
+    uint64_t *signature; // Bit literalKey % 64 set for each literal
+    int numClauses;
+    int clauseCapacity;
+    int literalCapacity;
+    int *slots;          // Hash table of clause index + 1 (0 = empty)
+    int slotCapacity;    // Power of two
+} ClauseSet;
+
+// Clauses clauseSetToDIMACS dropped on the way
+typedef struct
+{
+    long long products;    // Clause pairs merged by cross products
+    long long tautologies; // Merged clauses containing both x and ~x
+    long long duplicates;  // Clauses already in their set
+    long long subsumed;    // Clauses containing another clause of their set
+} ClauseSetStats;
+
+// What the CNF planner predicts and decides for one node. Counts saturate
+// at LLONG_MAX instead of overflowing.
+typedef struct
+{
+    long long clauses;  // CNF of the subtree as its parent sees it (1 when named)
+    long long literals;
+    long long distributeClauses;  // CNF of the subtree with no names at all
+    long long distributeLiterals;
+    int polarity;       // 1 or -1: the subtree, or its negation, is converted
+    bool named;         // Replaced by an auxiliary variable
+} CnfPlanEntry;
+
+// Plan for converting one tree, entries in post-order (children before
+// parents, the root last)
+typedef struct
+{
+    Node **nodes;
+    CnfPlanEntry *entries;
+    int numNodes;
+    long long budget;           // Largest CNF allowed for an OR before naming
+    int namedSubtrees;
+    long long totalClauses;     // Predicted output, definitions included
+    long long totalLiterals;
+    long long distributeClauses; // What plain distribution would produce
+    long long distributeLiterals;
+} CnfPlan;
+
+// One task of the parallel CNF conversion. A task combines operands
+// [first, last) of an operator node: a leaf task converts those operand
+// subtrees itself, any other task forks one child task per run of
+// operands and combines their results when the last one finishes.
+typedef struct CnfTask
+{
+    Node *node;
+    int first, last;
+    int polarity;               // Polarity of node (set when the parent forks)
+    bool flipped;               // Node is an operand of the parent's node with the opposite polarity
+    struct CnfTask **children;  // In operand order (NULL for a leaf task)
+    int numChildren;
+    struct CnfTask *parent;
+    int pending;                // Children not finished yet (updated atomically)
+    ClauseSet *result;
+} CnfTask;
+
+// Tasks of one worker. The owner pushes and pops at the tail; idle
+// workers steal the oldest task from the head.
+typedef struct
+{
+    CnfTask **tasks;
+    int head, tail;
+    pthread_mutex_t lock;
+} TaskDeque;
+
+// Work shared by the parallel CNF workers. Idle workers sleep on wake
+// until a task is pushed or the root is done.
+typedef struct
+{
+    TaskDeque *deques;
+    int numWorkers;
+    int queued;            // Tasks pushed and not taken yet (updated atomically)
+    int done;              // Set once the root task has its result
+    pthread_mutex_t lock;  // Guards sleeping on wake
+    pthread_cond_t wake;
+} CnfPool;
+
+// One parallel CNF worker, with its own node arena
+typedef struct
+{
+    CnfPool *pool;
+    int id;
+    NodeArena *arena;
+    int *scratch;
+    int scratchCapacity;
+    long long tasksRun;
+    long long steals;
+} CnfWorker;
+
+// What parallelConvertToDIMACS did
+typedef struct
+{
+    int tasks;
+    long long steals; // Tasks taken from another worker's deque
+} ParallelCnfStats;
+
+// Reusable state for spotting x and ~x in one clause. Literals are signed
+// symbol IDs, so no DIMACS numbering is needed. stamp[id] holds the
+// generation of the last clause that used id, shifted left once, with the
+// sign in the low bit; a new generation per clause means nothing is cleared.
+typedef struct
+{
+    unsigned int *stamp;
+    int capacity;            // Symbol IDs below this have a stamp
+    unsigned int generation;
+    int *literals;           // Literals of the clause being checked
+    int literalCapacity;
+} TautologyChecker;
+
+// Work shared by the isValidCNF threads
+typedef struct
+{
+    Node **clauses;
+    int numClauses;
+    int nextClause;    // Next chunk to hand out (updated atomically)
+    int firstInvalid;  // Lowest clause found not to be a tautology (updated atomically)
+} ValidityJob;
+
+// One stretch of a DIMACS body, scanned on its own. Its literals and the
+// literal count after each 0 are local; the merge shifts them into place.
+typedef struct
+{
+    const char *begin;
+    const char *end;
+    int numVars;
+    long long maxClauses; // A 0 past this many clauses is an error
+    int *literals;
+    size_t numLiterals;
+    size_t literalCapacity;
+    size_t *clauseEnds; // clauseEnds[k + 1]: literals before the k-th 0; clauseEnds[0] is 0
+    long long numClauses;
+    long long clauseCapacity;
+    bool stopped;        // Reached the % end marker
+    const char *error;   // First problem found, or NULL
+    const char *errorAt;
+    size_t literalOffset; // Where the merge puts this chunk
+    long long clauseOffset;
+    DIMACSFormula *formula;
+} DimacsChunk;
+
+// Clause lists kept back to back while fusedToDIMACS multiplies them out
+typedef struct
+{
+    int *literals;  // Clause i is literals[start[i] .. start[i + 1])
+    int numLiterals;
+    int literalCapacity;
+    int *start;     // numClauses + 1 entries
+    int numClauses;
+    int clauseCapacity;
+} ClauseStack;
+
+// Global variable mapping
+VarMapping varMap = {NULL, 0, NULL, 0, 0, 0};
+
+// Names of all variables seen so far (shared by every thread)
+SymbolTable symbols; // Zero-initialized: no names yet
+pthread_mutex_t symbolLock = PTHREAD_MUTEX_INITIALIZER;
+
+
+// Work stack shared by all tree walks on this thread
+_Thread_local WorkStack walkStack = {NULL, 0, 0};
+
+// Arena that createNode allocates from on this thread (NULL = malloc)
+_Thread_local NodeArena *currentArena = NULL;
+
+// Node allocation counters for this thread
+_Thread_local NodeStats nodeStats = {0, 0, 0, 0};
+
+#define ARENA_FIRST_BLOCK 1024
+#define ARENA_MAX_BLOCK 65536
+
+void countAllocation(long bytes)
+{
+    nodeStats.allocations++;
+    nodeStats.currentBytes += bytes;
+    if (nodeStats.currentBytes > nodeStats.peakBytes)
+        nodeStats.peakBytes = nodeStats.currentBytes;
+}
+
+void countFree(long bytes)
+{
+    nodeStats.frees++;
+    nodeStats.currentBytes -= bytes;
+}
+
+void resetNodeStats()
+{
+    nodeStats.allocations = 0;
+    nodeStats.frees = 0;
+    nodeStats.peakBytes = nodeStats.currentBytes;
+}
+
+NodeArena *createArena()
+{
+    NodeArena *arena = (NodeArena *)malloc(sizeof(NodeArena));
+    arena->first = NULL;
+    arena->current = NULL;
+    arena->nodeCount = 0;
+    return arena;
+}
+
+// Take count contiguous nodes from the arena, moving to the next block
+// when the current one is full. A block that is too small for the request
+// is not reused; a new one is inserted in front of it instead.
+Node *arenaAllocNodes(NodeArena *arena, int count)
+{
+    ArenaBlock *block = arena->current;
+
+    if (block == NULL || block->capacity - block->used < count)
+    {
+        ArenaBlock *next = (block != NULL) ? block->next : arena->first;
+
+        if (next == NULL || next->capacity < count)
+        {
+            int capacity = (block != NULL) ? block->capacity * 2 : ARENA_FIRST_BLOCK;
+            if (capacity > ARENA_MAX_BLOCK)
+                capacity = ARENA_MAX_BLOCK;
+            if (capacity < count)
+                capacity = count;
+
+            long bytes = sizeof(ArenaBlock) + (long)capacity * sizeof(Node);
+            ArenaBlock *added = (ArenaBlock *)malloc(bytes);
+            added->next = next;
+            added->capacity = capacity;
+            countAllocation(bytes);
+
+            if (block != NULL)
+                block->next = added;
+            else
+                arena->first = added;
+            next = added;
+        }
+
+        next->used = 0;
+        arena->current = next;
+        block = next;
+    }
+
+    Node *nodes = &block->nodes[block->used];
+    block->used += count;
+    arena->nodeCount += count;
+    return nodes;
+}
+
+Node *arenaAllocNode(NodeArena *arena)
+{
+    return arenaAllocNodes(arena, 1);
+}
+
+// Release every node of the arena at once. Blocks are kept for reuse.
+void resetArena(NodeArena *arena)
+{
+    arena->current = NULL;
+    arena->nodeCount = 0;
+}
+
+void destroyArena(NodeArena *arena)
+{
+    if (arena == NULL)
+        return;
+
+    ArenaBlock *block = arena->first;
+    while (block != NULL)
+    {
+        ArenaBlock *next = block->next;
+        countFree(sizeof(ArenaBlock) + (long)block->capacity * sizeof(Node));
+        free(block);
+        block = next;
+    }
+    free(arena);
+}
+
+// Make createNode allocate from arena on this thread; returns the
+// previous arena so callers can restore it
+NodeArena *setCurrentArena(NodeArena *arena)
+{
+    NodeArena *previous = currentArena;
+    currentArena = arena;
+    return previous;
+}
 
 // Function declarations (copy from main2.c)
 Node *createNode(char value);
+Node *createVarNode(int var, char value);
+int internSymbol(const char *name, int length);
+int findSymbol(const char *name);
+const char *symbolName(int id);
+Node *createNaryNode(char value, int count);
+void appendChild(Node *node, Node *child);
 int isOperator(char c);
 int isBinaryOperator(char c);
-int index_pos = 0;
-Node *parseExpression(char *formula);
-Node *parseOperand(char *formula);
+WalkFrame *pushFrame(Node *node, Node **slot, int state, int value);
+WalkFrame popFrame();
+void releaseWorkStack();
+NodeArena *createArena();
+void resetArena(NodeArena *arena);
+void destroyArena(NodeArena *arena);
+NodeArena *setCurrentArena(NodeArena *arena);
+void resetNodeStats();
+HashConsTable *createHashConsTable();
+void destroyHashConsTable(HashConsTable *table);
+Node *convertToCNFShared(HashConsTable *table, Node *root);
+void countSharing(Node *root, long *dagNodes, long *dagEdges, double *treeNodes);
+FlatTree *flattenTree(Node *root);
+Node *unflattenTree(FlatTree *flat);
+void freeFlatTree(FlatTree *flat);
+int evaluateFlat(FlatTree *flat, TruthAssignment *assignments, int numAssignments);
+int calculateFlatHeight(FlatTree *flat);
+void flatToPrefix(FlatTree *flat, char *result, int *resultIndex);
+void treeToInfix(Node *root, char *result, int *resultIndex);
+void flatToInfix(FlatTree *flat, char *result, int *resultIndex);
+void initParserState(ParserState *state, const char *source);
+void setParseError(ParserState *state, int position, const char *message);
+bool tokenize(ParserState *state);
+Node *parseExpression(ParserState *state);
+Node *parseFormula(const char *infixFormula, ParseError *error);
 Node *buildParseTree(char *infixFormula);
+void parseFormulasBatch(char **formulas, int count, Node **results, ParseError *errors, int numThreads);
 void treeToPrefix(Node *root, char *result, int *resultIndex);
 void infixToPrefix(char *infixFormula, char *prefixResult);
-Node *prefixToTree(char *prefix, int *index);
+Node *prefixToTree(ParserState *state);
 Node *buildTreeFromPrefix(char *prefix);
 void inorderTraversal(Node *root);
 int calculateHeight(Node *root);
-int getTruthValue(char variable, TruthAssignment *assignments, int numAssignments);
+int getTruthValue(int variable, TruthAssignment *assignments, int numAssignments);
 int evaluateFormula(Node *root, TruthAssignment *assignments, int numAssignments);
 Node *cloneTree(Node *root);
 Node *eliminateImplications(Node *root);
 Node *moveNegationsInward(Node *root);
 Node *distributeOrOverAnd(Node *root);
 Node *convertToCNF(Node *root);
+Node *flattenAssociative(Node *root);
+int countNodes(Node *root);
 void extractClauses(Node *root, Node **clauses, int *count, int maxClauses);
 bool isValidCNF(Node *cnfRoot);
-int getIntVar(char charVar);
-char getCharVar(int intVar);
+int getIntVar(int symbol);
+const char *getVarName(int intVar);
+void resetVarMapping();
 void extractLiterals(Node *clause, int *literals, int *litCount);
 DIMACSFormula *treeToDIMACS(Node *cnfRoot);
 void printDIMACS(DIMACSFormula *formula);
@@ -73,963 +746,8448 @@ bool evaluateDIMACS(DIMACSFormula *formula, int *assignment);
 void printVarMapping();
 void freeDIMACS(DIMACSFormula *formula);
 void freeTree(Node *root);
-void collectVariables(Node *root, char *vars, int *count);
+int *collectVariables(Node *root, int *count);
+Program *compileFormula(Node *root);
+int evaluateProgram(Program *program, const unsigned char *values);
+uint64_t evaluateProgramWords(Program *program, const uint64_t *values);
+uint64_t *computeTruthTable(Program *program);
+uint64_t *computeTruthTableSimd(Program *program, int level);
+int detectSimdLevel();
+const char *simdLevelName(int level);
+int availableCores();
+IncrementalCircuit *buildIncrementalCircuit(Node *root);
+uint64_t *grayCodeTruthTable(IncrementalCircuit *circuit, TruthRowSink sink, void *context);
+void freeIncrementalCircuit(IncrementalCircuit *circuit);
+uint64_t *cofactorTruthTable(Program *program, CofactorStats *stats);
+TableWriter *createTableWriter(int varCount);
+bool addTableSink(TableWriter *writer, FILE *file);
+void writeTableHeader(TableWriter *writer, Node *tree, int *vars, int varCount);
+void writeTableRow(void *context, long long row, int result);
+void destroyTableWriter(TableWriter *writer);
+bool saveTruthTableBinary(const char *filename, const uint64_t *table, int *vars, int varCount);
+TruthTableFile *openTruthTableFile(const char *filename);
+int truthTableFileRow(TruthTableFile *file, uint64_t row);
+void closeTruthTableFile(TruthTableFile *file);
+DIMACSFormula *tseitinToDIMACS(Node *root);
+DIMACSFormula *convertToDIMACS(Node *root, int mode, long long budget);
+DIMACSFormula *encodeGatesToDIMACS(Node *root, bool polarityAware);
+DIMACSFormula *tseitinToDIMACS(Node *root);
+DIMACSFormula *plaistedGreenbaumToDIMACS(Node *root);
+DIMACSFormula *clauseSetToDIMACS(Node *root, ClauseSetStats *stats);
+CnfPlan *planCNF(Node *root, long long budget);
+DIMACSFormula *plannedToDIMACS(Node *root, CnfPlan *plan);
+void freeCnfPlan(CnfPlan *plan);
+DIMACSFormula *parallelConvertToDIMACS(Node *root, int numThreads, ParallelCnfStats *stats);
+DIMACSFormula *fusedToDIMACS(Node *root);
+int findNonTautologicalClause(Node *cnfRoot, int numThreads);
+DIMACSFormula *createDIMACS(int layout);
+int dimacsClauseSize(const DIMACSFormula *formula, int i);
+int dimacsLiteral(const DIMACSFormula *formula, int i, int j);
+void flattenDIMACS(DIMACSFormula *formula, int layout);
+size_t dimacsBytes(const DIMACSFormula *formula);
+DIMACSFormula *treeToDIMACSAs(Node *cnfRoot, int layout);
+DIMACSFormula *readDIMACSAs(const char *filename, int layout);
+DIMACSFormula *readDIMACSParallel(const char *filename, int layout, int numThreads);
+uint64_t *enumerateTruthTable(Program *program, int numThreads, TruthRowSink sink, void *context,
+                              TruthTableSummary *summary);
+void freeProgram(Program *program);
 
 // Implementations (copy from main2.c)
 
 // Create a new node
 Node *createNode(char value)
 {
-    Node *newNode = (Node *)malloc(sizeof(Node));
+    Node *newNode;
+    if (currentArena != NULL)
+    {
+        newNode = arenaAllocNode(currentArena);
+        newNode->arenaOwned = 1;
+    }
+    else
+    {
+        newNode = (Node *)malloc(sizeof(Node));
+        newNode->arenaOwned = 0;
+        countAllocation(sizeof(Node));
+    }
     newNode->value = value;
+    newNode->childrenInArena = 0;
+    newNode->numChildren = 0;
     newNode->left = NULL;
     newNode->right = NULL;
+    newNode->children = NULL;
     return newNode;
 }
 
-// Check if character is an operator
-int isOperator(char c)
+// Release a single node; arena nodes are left to their arena
+void releaseNode(Node *node)
 {
-    return (c == '~' || c == '+' || c == '*' || c == '>');
+    if (!node->arenaOwned)
+    {
+        countFree(sizeof(Node));
+        free(node);
+    }
 }
 
-// Check if character is a binary operator
-int isBinaryOperator(char c)
+// Capacity of a children array holding count operands. Arrays grow by
+// doubling, so the capacity follows from the count and is not stored.
+int childCapacity(int count)
 {
-    return (c == '+' || c == '*' || c == '>');
+    int capacity = 4;
+    while (capacity < count)
+        capacity *= 2;
+    return capacity;
 }
 
-// Parse operand (variable or subexpression)
-Node *parseOperand(char *formula)
+// Release the children array of an n-ary node (not the children)
+void releaseChildren(Node *node)
 {
-    if (index_pos >= strlen(formula))
-    {
-        return NULL;
-    }
-
-    if (formula[index_pos] == '(')
-    {
-        return parseExpression(formula);
-    }
+    if (node->numChildren == 0)
+        return;
 
-    if (formula[index_pos] == '~')
+    if (!node->childrenInArena)
     {
-        return parseExpression(formula);
+        countFree(childCapacity(node->numChildren) * sizeof(Node *));
+        free(node->children);
     }
-
-    char var = formula[index_pos];
-    index_pos++;
-    return createNode(var);
+    node->children = NULL;
+    node->numChildren = 0;
 }
 
-// Parse expression recursively
-Node *parseExpression(char *formula)
+// Give node an array of count (uninitialized) children, taken from the
+// current arena when there is one
+Node **allocChildren(Node *node, int count)
 {
-    if (index_pos < strlen(formula) && formula[index_pos] == '(')
+    releaseChildren(node);
+
+    int capacity = childCapacity(count);
+    long bytes = capacity * sizeof(Node *);
+    if (currentArena != NULL)
     {
-        index_pos++;
+        node->children = (Node **)arenaAllocNodes(currentArena, (bytes + sizeof(Node) - 1) / sizeof(Node));
+        node->childrenInArena = 1;
     }
-
-    if (index_pos < strlen(formula) && formula[index_pos] == '~')
+    else
     {
-        index_pos++;
-        Node *operatorNode = createNode('~');
-        operatorNode->left = parseExpression(formula);
-
-        if (index_pos < strlen(formula) && formula[index_pos] == ')')
-        {
-            index_pos++;
-        }
-
-        return operatorNode;
+        node->children = (Node **)malloc(bytes);
+        node->childrenInArena = 0;
+        countAllocation(bytes);
     }
+    node->numChildren = count;
+    return node->children;
+}
 
-    Node *left = parseOperand(formula);
+// Create an n-ary AND/OR node with count operands to be filled in
+Node *createNaryNode(char value, int count)
+{
+    Node *node = createNode(value);
+    allocChildren(node, count);
+    return node;
+}
 
-    if (index_pos < strlen(formula) && isBinaryOperator(formula[index_pos]))
+// Append an operand to an n-ary node, doubling the array when it is full
+void appendChild(Node *node, Node *child)
+{
+    int count = node->numChildren;
+    if (count == childCapacity(count))
     {
-        char operator = formula[index_pos];
-        index_pos++;
+        Node **old = node->children;
+        char oldInArena = node->childrenInArena;
 
-        Node *right = parseOperand(formula);
+        node->numChildren = 0;
+        allocChildren(node, count + 1);
+        memcpy(node->children, old, count * sizeof(Node *));
 
-        Node *operatorNode = createNode(operator);
-        operatorNode->left = left;
-        operatorNode->right = right;
-
-        if (index_pos < strlen(formula) && formula[index_pos] == ')')
+        if (!oldInArena)
         {
-            index_pos++;
+            countFree(count * sizeof(Node *));
+            free(old);
         }
-
-        return operatorNode;
     }
+    node->children[count] = child;
+    node->numChildren = count + 1;
+}
+
+// ========== SYMBOL TABLE ==========
 
-    if (index_pos < strlen(formula) && formula[index_pos] == ')')
+// FNV-1a hash of a name
+uint64_t hashName(const char *name, int length)
+{
+    uint64_t h = 0xCBF29CE484222325ULL;
+    for (int i = 0; i < length; i++)
     {
-        index_pos++;
+        h ^= (unsigned char)name[i];
+        h *= 0x100000001B3ULL;
     }
-
-    return left;
+    return h;
 }
 
-// Build parse tree from infix formula
-Node *buildParseTree(char *infixFormula)
+// Name of a symbol ID. The pointer stays valid until freeSymbolTable.
+const char *symbolName(int id)
 {
-    index_pos = 0;
-    return parseExpression(infixFormula);
+    if (id < 1 || id > __atomic_load_n(&symbols.count, __ATOMIC_ACQUIRE))
+        return "?";
+    const char **block = __atomic_load_n(&symbols.blocks[id >> SYMBOL_BLOCK_BITS], __ATOMIC_ACQUIRE);
+    return block[id & ((1 << SYMBOL_BLOCK_BITS) - 1)];
 }
 
-// Convert parse tree to prefix notation
-void treeToPrefix(Node *root, char *result, int *resultIndex)
+// Keep a block to free with the table (lock held)
+void retireSymbolMemory(void *memory)
 {
-    if (root == NULL)
+    if (symbols.numRetired == symbols.retiredCapacity)
     {
-        return;
+        symbols.retiredCapacity = symbols.retiredCapacity > 0 ? symbols.retiredCapacity * 2 : 64;
+        symbols.retired = (void **)realloc(symbols.retired, symbols.retiredCapacity * sizeof(void *));
     }
+    symbols.retired[symbols.numRetired++] = memory;
+}
 
-    result[(*resultIndex)++] = root->value;
-    result[(*resultIndex)++] = ' ';
+// Slot holding the name in a table, or the empty slot where it would go
+int *findSymbolSlot(SymbolSlots *table, const char *name, int length)
+{
+    uint64_t mask = table->capacity - 1;
+    uint64_t slot = hashName(name, length) & mask;
 
-    treeToPrefix(root->left, result, resultIndex);
-    treeToPrefix(root->right, result, resultIndex);
+    while (1)
+    {
+        int id = __atomic_load_n(&table->ids[slot], __ATOMIC_ACQUIRE);
+        if (id == 0)
+            break;
+        const char *candidate = symbolName(id);
+        if (strncmp(candidate, name, length) == 0 && candidate[length] == '\0')
+            break;
+        slot = (slot + 1) & mask;
+    }
+    return &table->ids[slot];
 }
 
-// Convert infix to prefix
-void infixToPrefix(char *infixFormula, char *prefixResult)
+// Publish a table twice the size (lock held). Readers still probing the
+// old one find nothing new there and fall through to the lock.
+void growSymbolSlots()
 {
-    Node *root = buildParseTree(infixFormula);
-
-    int resultIndex = 0;
-    treeToPrefix(root, prefixResult, &resultIndex);
+    SymbolSlots *old = symbols.slots;
+    int capacity = old != NULL ? old->capacity * 2 : 1024;
+    SymbolSlots *table = (SymbolSlots *)calloc(1, sizeof(SymbolSlots) + capacity * sizeof(int));
+    table->capacity = capacity;
 
-    if (resultIndex > 0 && prefixResult[resultIndex - 1] == ' ')
+    for (int i = 0; old != NULL && i < old->capacity; i++)
     {
-        resultIndex--;
+        int id = old->ids[i];
+        if (id == 0)
+            continue;
+
+        const char *name = symbolName(id);
+        *findSymbolSlot(table, name, strlen(name)) = id;
     }
-    prefixResult[resultIndex] = '\0';
 
-    freeTree(root);
+    __atomic_store_n(&symbols.slots, table, __ATOMIC_RELEASE);
+    if (old != NULL)
+        retireSymbolMemory(old);
 }
 
-// TASK 2: Build parse tree from prefix expression
-Node *prefixToTree(char *prefix, int *index)
+// ID of the first length characters of name, or 0 if not interned.
+// Takes no lock.
+int lookupSymbol(const char *name, int length)
 {
-    while (prefix[*index] == ' ')
-    {
-        (*index)++;
-    }
+    SymbolSlots *table = __atomic_load_n(&symbols.slots, __ATOMIC_ACQUIRE);
+    if (table == NULL)
+        return 0;
+    return __atomic_load_n(findSymbolSlot(table, name, length), __ATOMIC_ACQUIRE);
+}
 
-    if (prefix[*index] == '\0')
-    {
-        return NULL;
-    }
+// Return the ID of the first length characters of name, adding the name
+// if it is new. Safe to call from several threads; names already seen
+// are found without the lock.
+int internSymbol(const char *name, int length)
+{
+    int id = lookupSymbol(name, length);
+    if (id != 0)
+        return id;
 
-    char current = prefix[*index];
-    (*index)++;
+    pthread_mutex_lock(&symbolLock);
 
-    Node *node = createNode(current);
+    if (symbols.slots == NULL || (symbols.count + 1) * 2 > symbols.slots->capacity)
+        growSymbolSlots();
 
-    if (isOperator(current))
+    int *slot = findSymbolSlot(symbols.slots, name, length);
+    if (*slot == 0)
     {
-        node->left = prefixToTree(prefix, index);
+        id = symbols.count + 1;
+        if (id >> SYMBOL_BLOCK_BITS >= SYMBOL_BLOCKS)
+        {
+            printf("Error: Too many variable names\n");
+            exit(1);
+        }
 
-        if (isBinaryOperator(current))
+        if (symbols.chunkUsed + length + 1 > symbols.chunkSize)
         {
-            node->right = prefixToTree(prefix, index);
+            // Start a new chunk; the full one keeps its names where they are
+            symbols.chunkSize = length + 1 > SYMBOL_CHUNK_BYTES ? length + 1 : SYMBOL_CHUNK_BYTES;
+            symbols.chunk = (char *)malloc(symbols.chunkSize);
+            symbols.chunkUsed = 0;
+            retireSymbolMemory(symbols.chunk);
         }
+        char *copy = symbols.chunk + symbols.chunkUsed;
+        memcpy(copy, name, length);
+        copy[length] = '\0';
+        symbols.chunkUsed += length + 1;
+
+        const char ***block = &symbols.blocks[id >> SYMBOL_BLOCK_BITS];
+        if (*block == NULL)
+            __atomic_store_n(block, (const char **)malloc(sizeof(char *) << SYMBOL_BLOCK_BITS), __ATOMIC_RELEASE);
+        (*block)[id & ((1 << SYMBOL_BLOCK_BITS) - 1)] = copy;
+
+        // The name is in place before anyone can see the ID
+        __atomic_store_n(&symbols.count, id, __ATOMIC_RELEASE);
+        __atomic_store_n(slot, id, __ATOMIC_RELEASE);
     }
 
-    return node;
+    id = *slot;
+    pthread_mutex_unlock(&symbolLock);
+    return id;
 }
 
-Node *buildTreeFromPrefix(char *prefix)
+// ID of a name, or 0 if it has never been interned
+int findSymbol(const char *name)
 {
-    int index = 0;
-    return prefixToTree(prefix, &index);
+    return lookupSymbol(name, strlen(name));
 }
 
-// TASK 3: In-order traversal to get infix expression
-void inorderTraversal(Node *root)
+void freeSymbolTable()
 {
-    if (root == NULL)
-        return;
-
-    if (isOperator(root->value))
-    {
-        printf("(");
-    }
-
-    if (root->value == '~')
+    for (int i = 0; i < symbols.numRetired; i++)
     {
-        printf("~");
-        inorderTraversal(root->left);
+        free(symbols.retired[i]);
     }
-    else
+    for (int b = 0; b < SYMBOL_BLOCKS && symbols.blocks[b] != NULL; b++)
     {
-        inorderTraversal(root->left);
-        printf("%c", root->value);
-        inorderTraversal(root->right);
+        free(symbols.blocks[b]);
     }
+    free(symbols.retired);
+    free(symbols.slots);
+    memset(&symbols, 0, sizeof(symbols));
+}
 
-    if (isOperator(root->value))
-    {
-        printf(")");
-    }
+// Create a variable leaf. value keeps the first character of the name.
+Node *createVarNode(int var, char value)
+{
+    Node *node = createNode(value);
+    node->var = var;
+    return node;
 }
 
-// TASK 4: Calculate height of parse tree
-int calculateHeight(Node *root)
+// Push a frame on this thread's work stack. The returned pointer is only
+// valid until the next push.
+WalkFrame *pushFrame(Node *node, Node **slot, int state, int value)
 {
-    if (root == NULL)
+    if (walkStack.top == walkStack.capacity)
     {
-        return -1;
+        walkStack.capacity = walkStack.capacity > 0 ? walkStack.capacity * 2 : 256;
+        walkStack.frames = (WalkFrame *)realloc(walkStack.frames, walkStack.capacity * sizeof(WalkFrame));
     }
 
-    int leftHeight = calculateHeight(root->left);
-    int rightHeight = calculateHeight(root->right);
-
-    return 1 + (leftHeight > rightHeight ? leftHeight : rightHeight);
+    WalkFrame *frame = &walkStack.frames[walkStack.top++];
+    frame->node = node;
+    frame->slot = slot;
+    frame->state = state;
+    frame->value = value;
+    return frame;
 }
 
-// TASK 5: Evaluate truth value of formula
-int getTruthValue(char variable, TruthAssignment *assignments, int numAssignments)
+WalkFrame popFrame()
 {
-    for (int i = 0; i < numAssignments; i++)
-    {
-        if (assignments[i].variable == variable)
-        {
-            return assignments[i].value;
-        }
-    }
-    return -1;
+    return walkStack.frames[--walkStack.top];
 }
 
-int evaluateFormula(Node *root, TruthAssignment *assignments, int numAssignments)
+// Release this thread's work stack (worker threads call it before exiting)
+void releaseWorkStack()
 {
-    if (root == NULL)
-    {
-        return -1;
-    }
+    free(walkStack.frames);
+    walkStack.frames = NULL;
+    walkStack.top = 0;
+    walkStack.capacity = 0;
+}
 
-    if (!isOperator(root->value))
-    {
-        return getTruthValue(root->value, assignments, numAssignments);
-    }
+// Check if character is an operator
+int isOperator(char c)
+{
+    return (c == '~' || c == '+' || c == '*' || c == '>');
+}
 
-    int leftVal = evaluateFormula(root->left, assignments, numAssignments);
-    int rightVal = (root->right != NULL) ? evaluateFormula(root->right, assignments, numAssignments) : 0;
+// Check if character is a binary operator
+int isBinaryOperator(char c)
+{
+    return (c == '+' || c == '*' || c == '>');
+}
 
-    switch (root->value)
+// Text of a node: its operator, or the variable name. buffer must hold
+// two characters.
+const char *nodeText(Node *node, char *buffer)
+{
+    if (isOperator(node->value))
     {
-    case '~':
-        return !leftVal;
-    case '+':
-        return leftVal || rightVal;
-    case '*':
-        return leftVal && rightVal;
-    case '>':
-        return !leftVal || rightVal;
-    default:
-        return -1;
+        buffer[0] = node->value;
+        buffer[1] = '\0';
+        return buffer;
     }
+    return symbolName(node->var);
 }
 
-// TASK 6: CNF Conversion Helper Functions
+// Forward declarations
+Node *parseExpression(ParserState *state);
+void freeTree(Node *root);
+void extractLiterals(Node *clause, int *literals, int *litCount);
+void resetVarMapping();
+int *collectVariables(Node *root, int *count);
+int countNodes(Node *root);
 
-Node *cloneTree(Node *root)
+// Prepare a parser state for the given formula
+void initParserState(ParserState *state, const char *source)
 {
-    if (root == NULL)
-        return NULL;
-
-    Node *newNode = createNode(root->value);
-    newNode->left = cloneTree(root->left);
-    newNode->right = cloneTree(root->right);
-
-    return newNode;
+    state->source = source;
+    state->tokens = NULL;
+    state->pos = 0;
+    state->error.position = -1;
+    state->error.message = NULL;
 }
 
-Node *eliminateImplications(Node *root)
+// Record a parse error (the first one wins)
+void setParseError(ParserState *state, int position, const char *message)
 {
-    if (root == NULL)
-        return NULL;
-
-    root->left = eliminateImplications(root->left);
-    root->right = eliminateImplications(root->right);
-
-    if (root->value == '>')
+    if (state->error.position < 0)
     {
-        Node *notNode = createNode('~');
-        notNode->left = root->left;
-
-        Node *orNode = createNode('+');
-        orNode->left = notNode;
-        orNode->right = root->right;
-
-        free(root);
-        return orNode;
+        state->error.position = position;
+        state->error.message = message;
     }
+}
 
-    return root;
+// Characters that can appear in a variable name: x_1234, req.valid
+int isIdentifierChar(char c)
+{
+    return isgraph((unsigned char)c) && !isOperator(c) && c != '(' && c != ')';
 }
 
-Node *moveNegationsInward(Node *root)
+// Split the formula into tokens in a single pass. The array ends with a
+// '\0' token so the parser never needs to check the length.
+bool tokenize(ParserState *state)
 {
-    if (root == NULL)
-        return NULL;
+    const char *formula = state->source;
+    int capacity = 16;
+    int count = 0;
+    Token *tokens = (Token *)malloc(capacity * sizeof(Token));
 
-    if (root->value != '~')
+    for (int i = 0;; i++)
     {
-        root->left = moveNegationsInward(root->left);
-        root->right = moveNegationsInward(root->right);
-        return root;
-    }
-
-    if (root->left != NULL && root->left->value == '~')
-    {
-        Node *temp = root->left->left;
-        free(root->left);
-        free(root);
-        return moveNegationsInward(temp);
-    }
+        unsigned char c = (unsigned char)formula[i];
 
-    if (root->left != NULL && root->left->value == '*')
-    {
-        Node *andNode = root->left;
-
-        Node *notLeft = createNode('~');
-        notLeft->left = andNode->left;
+        if (isspace(c))
+            continue;
 
-        Node *notRight = createNode('~');
-        notRight->left = andNode->right;
+        if (count == capacity)
+        {
+            capacity *= 2;
+            tokens = (Token *)realloc(tokens, capacity * sizeof(Token));
+        }
 
-        Node *orNode = createNode('+');
-        orNode->left = moveNegationsInward(notLeft);
-        orNode->right = moveNegationsInward(notRight);
+        Token *token = &tokens[count];
+        token->pos = i;
+        token->value = (char)c;
 
-        free(andNode);
-        free(root);
-        return orNode;
+        if (c == '\0')
+        {
+            token->type = '\0';
+            break;
+        }
+        else if (c == '(' || c == ')' || isOperator((char)c))
+        {
+            token->type = (char)c;
+        }
+        else if (isgraph(c))
+        {
+            // A variable name runs up to the next space, operator or parenthesis
+            int length = 1;
+            while (isIdentifierChar(formula[i + length]))
+                length++;
+
+            token->type = 'v';
+            token->var = internSymbol(formula + i, length);
+            i += length - 1;
+        }
+        else
+        {
+            setParseError(state, i, "invalid character");
+            free(tokens);
+            return false;
+        }
+        count++;
     }
 
-    if (root->left != NULL && root->left->value == '+')
-    {
-        Node *orNode = root->left;
-
-        Node *notLeft = createNode('~');
-        notLeft->left = orNode->left;
-
-        Node *notRight = createNode('~');
-        notRight->left = orNode->right;
-
-        Node *andNode = createNode('*');
-        andNode->left = moveNegationsInward(notLeft);
-        andNode->right = moveNegationsInward(notRight);
+    state->tokens = tokens;
+    state->pos = 0;
+    return true;
+}
 
-        free(orNode);
-        free(root);
-        return andNode;
-    }
+// Parser frame kinds and modes for parseExpression
+#define PARSE_NOT 0   // Waiting for the operand of '~'
+#define PARSE_PAREN 1 // Waiting for the ')' closing a group
+#define PARSE_CHAIN 2 // Chain of operands joined by one operator
 
-    return root;
-}
+#define MODE_EXPRESSION 0
+#define MODE_OPERAND 1
+#define MODE_REDUCE 2
 
-Node *distributeOrOverAnd(Node *root)
+// Parse expression: a negation, or a chain of operands joined by one operator.
+// Two operands give a binary node; longer chains of '+' or '*' give one
+// n-ary node with the operands in order. '>' needs explicit parentheses.
+// Nesting is tracked on the work stack, so depth is limited only by memory.
+Node *parseExpression(ParserState *state)
 {
-    if (root == NULL)
-        return NULL;
-
-    root->left = distributeOrOverAnd(root->left);
-    root->right = distributeOrOverAnd(root->right);
+    int base = walkStack.top;
+    int mode = MODE_EXPRESSION;
+    Node *result = NULL;
 
-    if (root->value == '+')
+    while (1)
     {
-        if (root->left != NULL && root->left->value == '*')
-        {
-            Node *andNode = root->left;
+        Token *token = &state->tokens[state->pos];
 
-            // Clone all components we need
-            Node *p = cloneTree(andNode->left);
-            Node *q = cloneTree(andNode->right);
-            Node *r = cloneTree(root->right);
+        if (mode == MODE_EXPRESSION)
+        {
+            if (token->type == '~')
+            {
+                pushFrame(NULL, NULL, PARSE_NOT, 0);
+                state->pos++;
+                continue;
+            }
+            pushFrame(NULL, NULL, PARSE_CHAIN, 0);
+            mode = MODE_OPERAND;
+            continue;
+        }
 
-            // Build (p + r) and (q + r)
-            Node *or1 = createNode('+');
-            or1->left = p;
-            or1->right = cloneTree(r); // Need separate clone for or1
+        if (mode == MODE_OPERAND)
+        {
+            if (token->type == '(')
+            {
+                pushFrame(NULL, NULL, PARSE_PAREN, 0);
+                state->pos++;
+                mode = MODE_EXPRESSION;
+            }
+            else if (token->type == '~')
+            {
+                // A negation in operand position covers the rest of the group
+                mode = MODE_EXPRESSION;
+            }
+            else if (token->type == 'v')
+            {
+                result = createVarNode(token->var, token->value);
+                state->pos++;
+                mode = MODE_REDUCE;
+            }
+            else
+            {
+                setParseError(state, token->pos,
+                              token->type == '\0' ? "unexpected end of formula" : "expected a variable or '('");
+                break;
+            }
+            continue;
+        }
 
-            Node *or2 = createNode('+');
-            or2->left = q;
-            or2->right = r; // Use the original r clone for or2
+        // MODE_REDUCE: hand the finished subtree to the innermost open frame
+        if (walkStack.top == base)
+        {
+            return result;
+        }
 
-            Node *newAnd = createNode('*');
-            newAnd->left = distributeOrOverAnd(or1);
-            newAnd->right = distributeOrOverAnd(or2);
+        WalkFrame *frame = &walkStack.frames[walkStack.top - 1];
 
-            free(andNode);
-            free(root);
-            return newAnd;
+        if (frame->state == PARSE_NOT)
+        {
+            Node *operatorNode = createNode('~');
+            operatorNode->left = result;
+            result = operatorNode;
+            walkStack.top--;
+            continue;
         }
 
-        if (root->right != NULL && root->right->value == '*')
+        if (frame->state == PARSE_PAREN)
         {
-            Node *andNode = root->right;
-
-            // Clone all components we need
-            Node *p = cloneTree(root->left);
-            Node *q = cloneTree(andNode->left);
-            Node *r = cloneTree(andNode->right);
-
-            // Build (p + q) and (p + r)
-            Node *or1 = createNode('+');
-            or1->left = cloneTree(p); // Need separate clone for or1
-            or1->right = q;
+            if (token->type != ')')
+            {
+                setParseError(state, token->pos, "expected ')'");
+                break;
+            }
+            state->pos++;
+            walkStack.top--;
+            continue;
+        }
 
-            Node *or2 = createNode('+');
-            or2->left = p; // Use the original p clone for or2
-            or2->right = r;
+        // Chain frame value: operator in the low byte, operands seen above it
+        char op = (char)(frame->value & 0xFF);
+        int operands = frame->value >> 8;
 
-            Node *newAnd = createNode('*');
-            newAnd->left = distributeOrOverAnd(or1);
-            newAnd->right = distributeOrOverAnd(or2);
+        if (operands == 0)
+        {
+            frame->node = result;
+        }
+        else if (operands == 1)
+        {
+            Node *operatorNode = createNode(op);
+            operatorNode->left = frame->node;
+            operatorNode->right = result;
+            frame->node = operatorNode;
+        }
+        else if (operands == 2)
+        {
+            // Third operand: the chain becomes one n-ary node
+            Node *chain = frame->node;
+            allocChildren(chain, 3);
+            chain->children[0] = chain->left;
+            chain->children[1] = chain->right;
+            chain->children[2] = result;
+            chain->left = NULL;
+            chain->right = NULL;
+        }
+        else
+        {
+            appendChild(frame->node, result);
+        }
+        result = NULL;
+        operands++;
+        frame->value = (operands << 8) | (unsigned char)op;
 
-            free(andNode);
-            free(root);
-            return newAnd;
+        if (isBinaryOperator(token->type))
+        {
+            if (op == '>')
+            {
+                setParseError(state, token->pos, "chained '>' needs parentheses");
+                break;
+            }
+            if (op != 0 && token->type != op)
+            {
+                setParseError(state, token->pos, "mixed operators need parentheses");
+                break;
+            }
+            frame->value = (operands << 8) | token->type;
+            state->pos++;
+            mode = MODE_OPERAND;
+            continue;
         }
+
+        result = frame->node;
+        walkStack.top--;
     }
 
-    return root;
+    // Error: release the partial trees still held by open frames
+    freeTree(result);
+    while (walkStack.top > base)
+    {
+        freeTree(popFrame().node);
+    }
+    return NULL;
 }
 
-Node *convertToCNF(Node *root)
+// Parse an infix formula, reporting the position of the first error
+Node *parseFormula(const char *infixFormula, ParseError *error)
 {
-    if (root == NULL)
-        return NULL;
+    ParserState state;
+    initParserState(&state, infixFormula);
 
-    root = eliminateImplications(root);
-    root = moveNegationsInward(root);
-    root = distributeOrOverAnd(root);
+    Node *root = NULL;
+    if (tokenize(&state))
+    {
+        root = parseExpression(&state);
+
+        Token *last = &state.tokens[state.pos];
+        if (root != NULL && last->type != '\0')
+        {
+            setParseError(&state, last->pos, "unexpected input after formula");
+            freeTree(root);
+            root = NULL;
+        }
+        free(state.tokens);
+    }
 
+    if (error != NULL)
+        *error = state.error;
     return root;
 }
 
-// TASK 7: Validity Check
-void extractClauses(Node *root, Node **clauses, int *count, int maxClauses)
+// Build parse tree from infix formula
+Node *buildParseTree(char *infixFormula)
 {
-    if (root == NULL || *count >= maxClauses)
-        return;
+    ParseError error;
+    Node *root = parseFormula(infixFormula, &error);
 
-    if (root->value == '*')
-    {
-        extractClauses(root->left, clauses, count, maxClauses);
-        extractClauses(root->right, clauses, count, maxClauses);
-    }
-    else
+    if (root == NULL)
     {
-        clauses[(*count)++] = root;
+        printf("Parse error at position %d: %s\n", error.position + 1, error.message);
     }
+    return root;
 }
 
-bool isValidCNF(Node *cnfRoot)
-{
-    if (cnfRoot == NULL)
-        return false;
-
-    Node *clauses[100];
-    int clauseCount = 0;
-    extractClauses(cnfRoot, clauses, &clauseCount, 100);
+#define PARSE_BATCH_CHUNK 32
 
-    if (clauseCount == 0)
-        return false;
+void *parseBatchWorker(void *arg)
+{
+    ParseBatch *batch = (ParseBatch *)arg;
 
-    for (int i = 0; i < clauseCount; i++)
+    while (1)
     {
-        int literals[50];
-        int litCount = 0;
-        varMapSize = 0; // Reset mapping for each clause
-        extractLiterals(clauses[i], literals, &litCount);
-
-        // Check for complementary pair
-        bool foundComplementary = false;
-        for (int j = 0; j < litCount; j++)
-        {
-            for (int k = 0; k < litCount; k++)
-            {
-                if (j != k && literals[j] == -literals[k])
-                {
-                    foundComplementary = true;
-                    break;
-                }
-            }
-            if (foundComplementary)
-                break;
-        }
-        if (!foundComplementary)
-        {
-            return false;
-        }
-    }
-    return true;
-}
+        int start = __atomic_fetch_add(&batch->nextIndex, PARSE_BATCH_CHUNK, __ATOMIC_RELAXED);
+        if (start >= batch->count)
+            break;
 
-// ========== DIMACS FORMAT SUPPORT ==========
+        int end = start + PARSE_BATCH_CHUNK;
+        if (end > batch->count)
+            end = batch->count;
 
-// Get or create integer variable for a character variable
-int getIntVar(char charVar)
-{
-    for (int i = 0; i < varMapSize; i++)
-    {
-        if (varMap[i].charVar == charVar)
+        for (int i = start; i < end; i++)
         {
-            return varMap[i].intVar;
+            batch->results[i] = parseFormula(batch->formulas[i],
+                                             batch->errors != NULL ? &batch->errors[i] : NULL);
         }
     }
-
-    // Create new mapping
-    varMap[varMapSize].charVar = charVar;
-    varMap[varMapSize].intVar = varMapSize + 1;
-    varMapSize++;
-
-    return varMapSize;
+    return NULL;
 }
 
-// Get character variable from integer
-char getCharVar(int intVar)
+// Thread entry for the extra batch workers
+void *parseBatchThread(void *arg)
 {
-    for (int i = 0; i < varMapSize; i++)
-    {
-        if (varMap[i].intVar == intVar)
-        {
-            return varMap[i].charVar;
-        }
-    }
-    return '?';
+    parseBatchWorker(arg);
+    releaseWorkStack();
+    return NULL;
 }
 
-// Extract literals from a clause (OR expression)
-void extractLiterals(Node *clause, int *literals, int *litCount)
+// Parse an array of infix formulas on numThreads worker threads.
+// results[i] receives the tree for formulas[i] (NULL on error, with the
+// error stored in errors[i] when errors is not NULL).
+void parseFormulasBatch(char **formulas, int count, Node **results, ParseError *errors, int numThreads)
 {
-    if (clause == NULL)
-        return;
+    ParseBatch batch = {formulas, results, errors, count, 0};
 
-    // If it's an OR node, recursively extract from both sides
-    if (clause->value == '+')
-    {
-        extractLiterals(clause->left, literals, litCount);
-        extractLiterals(clause->right, literals, litCount);
-    }
-    // If it's a negation
-    else if (clause->value == '~')
+    if (numThreads < 1)
+        numThreads = 1;
+
+    pthread_t *threads = (pthread_t *)malloc(numThreads * sizeof(pthread_t));
+    int started = 0;
+    for (int i = 1; i < numThreads; i++)
     {
-        if (clause->left != NULL && !isOperator(clause->left->value))
-        {
-            int varNum = getIntVar(clause->left->value);
-            literals[(*litCount)++] = -varNum;
-        }
+        if (pthread_create(&threads[started], NULL, parseBatchThread, &batch) == 0)
+            started++;
     }
-    // If it's a literal (variable)
-    else if (!isOperator(clause->value))
+
+    // The calling thread works too
+    parseBatchWorker(&batch);
+
+    for (int i = 0; i < started; i++)
     {
-        int varNum = getIntVar(clause->value);
-        literals[(*litCount)++] = varNum;
+        pthread_join(threads[i], NULL);
     }
+    free(threads);
 }
 
-// Convert parse tree (CNF) to DIMACS format
-DIMACSFormula *treeToDIMACS(Node *cnfRoot)
+// Convert parse tree to prefix notation
+void treeToPrefix(Node *root, char *result, int *resultIndex)
 {
-    DIMACSFormula *formula = (DIMACSFormula *)malloc(sizeof(DIMACSFormula));
-
-    // Reset variable mapping
-    varMapSize = 0;
-
-    // Extract all clauses
-    Node *clauseNodes[100];
-    int clauseCount = 0;
-    extractClauses(cnfRoot, clauseNodes, &clauseCount, 100);
-
-    // Allocate memory for clauses
-    formula->clauses = (Clause *)malloc(clauseCount * sizeof(Clause));
-    formula->numClauses = clauseCount;
-
-    // Convert each clause
-    for (int i = 0; i < clauseCount; i++)
+    if (root == NULL)
     {
-        int literals[50];
-        int litCount = 0;
+        return;
+    }
 
-        extractLiterals(clauseNodes[i], literals, &litCount);
+    int base = walkStack.top;
+    pushFrame(root, NULL, 0, 0);
 
-        formula->clauses[i].literals = (int *)malloc(litCount * sizeof(int));
-        formula->clauses[i].size = litCount;
+    while (walkStack.top > base)
+    {
+        Node *node = popFrame().node;
 
-        for (int j = 0; j < litCount; j++)
+        if (isOperator(node->value))
         {
-            formula->clauses[i].literals[j] = literals[j];
+            result[(*resultIndex)++] = node->value;
         }
-    }
-
-    formula->numVars = varMapSize;
-
-    return formula;
-}
-
-// Print DIMACS format
-void printDIMACS(DIMACSFormula *formula)
-{
-    printf("c DIMACS CNF Format\n");
-    printf("c Generated from parse tree\n");
-    printf("p cnf %d %d\n", formula->numVars, formula->numClauses);
+        else
+        {
+            const char *name = symbolName(node->var);
+            while (*name != '\0')
+                result[(*resultIndex)++] = *name++;
+        }
+        result[(*resultIndex)++] = ' ';
 
-    for (int i = 0; i < formula->numClauses; i++)
-    {
-        for (int j = 0; j < formula->clauses[i].size; j++)
+        if (node->numChildren > 0)
         {
-            printf("%d ", formula->clauses[i].literals[j]);
+            // Same text as the left-deep binary chain: "+ + a b c"
+            for (int i = 2; i < node->numChildren; i++)
+            {
+                result[(*resultIndex)++] = node->value;
+                result[(*resultIndex)++] = ' ';
+            }
+            for (int i = node->numChildren - 1; i >= 0; i--)
+                pushFrame(node->children[i], NULL, 0, 0);
+            continue;
         }
-        printf("0\n");
+
+        if (node->right != NULL)
+            pushFrame(node->right, NULL, 0, 0);
+        if (node->left != NULL)
+            pushFrame(node->left, NULL, 0, 0);
     }
 }
 
-// Save DIMACS to file
-void saveDIMACS(DIMACSFormula *formula, const char *filename)
+// Convert infix to prefix
+void infixToPrefix(char *infixFormula, char *prefixResult)
 {
-    FILE *file = fopen(filename, "w");
-    if (file == NULL)
-    {
-        printf("Error: Cannot open file %s\n", filename);
-        return;
-    }
+    Node *root = buildParseTree(infixFormula);
 
-    fprintf(file, "c DIMACS CNF Format\n");
-    fprintf(file, "c Generated from parse tree\n");
-    fprintf(file, "p cnf %d %d\n", formula->numVars, formula->numClauses);
+    int resultIndex = 0;
+    treeToPrefix(root, prefixResult, &resultIndex);
 
-    for (int i = 0; i < formula->numClauses; i++)
+    if (resultIndex > 0 && prefixResult[resultIndex - 1] == ' ')
     {
-        for (int j = 0; j < formula->clauses[i].size; j++)
-        {
-            fprintf(file, "%d ", formula->clauses[i].literals[j]);
-        }
-        fprintf(file, "0\n");
+        resultIndex--;
     }
+    prefixResult[resultIndex] = '\0';
 
-    fclose(file);
-    printf("DIMACS formula saved to %s\n", filename);
+    freeTree(root);
 }
 
-// Read DIMACS from file
-DIMACSFormula *readDIMACS(const char *filename)
+// TASK 2: Build parse tree from prefix expression
+// Each frame is an empty child slot waiting for the next prefix token.
+Node *prefixToTree(ParserState *state)
 {
-    FILE *file = fopen(filename, "r");
-    if (file == NULL)
-    {
-        printf("Error: Cannot open file %s\n", filename);
-        return NULL;
-    }
+    const char *prefix = state->source;
+    Node *root = NULL;
+    int base = walkStack.top;
 
-    DIMACSFormula *formula = (DIMACSFormula *)malloc(sizeof(DIMACSFormula));
-    char line[1024];
-    int numVars = 0, numClauses = 0;
-    int clauseIndex = 0;
+    pushFrame(NULL, &root, 0, 0);
 
-    // Read header
-    while (fgets(line, sizeof(line), file))
+    while (walkStack.top > base)
     {
-        if (line[0] == 'c')
-            continue; // Comment line
+        WalkFrame frame = popFrame();
 
-        if (line[0] == 'p')
+        while (prefix[state->pos] == ' ')
         {
-            sscanf(line, "p cnf %d %d", &numVars, &numClauses);
-            formula->numVars = numVars;
-            formula->numClauses = numClauses;
-            formula->clauses = (Clause *)malloc(numClauses * sizeof(Clause));
-            break;
+            state->pos++;
         }
-    }
 
-    // Read clauses
-    while (fgets(line, sizeof(line), file) && clauseIndex < numClauses)
-    {
-        if (line[0] == 'c' || line[0] == '%' || line[0] == '0')
+        if (prefix[state->pos] == '\0')
+        {
             continue;
+        }
 
-        int literals[100];
-        int litCount = 0;
+        char current = prefix[state->pos];
+        Node *node;
 
-        char *token = strtok(line, " \t\n");
-        while (token != NULL)
+        if (isOperator(current))
         {
-            int lit = atoi(token);
-            if (lit == 0)
-                break;
-            literals[litCount++] = lit;
-            token = strtok(NULL, " \t\n");
+            node = createNode(current);
+            state->pos++;
         }
-
-        if (litCount > 0)
+        else
         {
-            formula->clauses[clauseIndex].literals = (int *)malloc(litCount * sizeof(int));
-            formula->clauses[clauseIndex].size = litCount;
+            // Variable names are separated by spaces or operators
+            int length = 1;
+            while (prefix[state->pos + length] != ' ' && prefix[state->pos + length] != '\0' &&
+                   !isOperator(prefix[state->pos + length]))
+                length++;
+
+            node = createVarNode(internSymbol(prefix + state->pos, length), current);
+            state->pos += length;
+        }
+        *frame.slot = node;
 
-            for (int i = 0; i < litCount; i++)
+        if (isOperator(current))
+        {
+            if (isBinaryOperator(current))
             {
-                formula->clauses[clauseIndex].literals[i] = literals[i];
+                pushFrame(NULL, &node->right, 0, 0);
             }
-
-            clauseIndex++;
+            pushFrame(NULL, &node->left, 0, 0);
         }
     }
 
-    fclose(file);
-    printf("DIMACS formula loaded: %d variables, %d clauses\n", numVars, clauseIndex);
-    return formula;
+    return root;
 }
 
-// Evaluate DIMACS formula with assignment
-bool evaluateDIMACS(DIMACSFormula *formula, int *assignment)
+Node *buildTreeFromPrefix(char *prefix)
 {
-    // Formula is true if all clauses are true
-    for (int i = 0; i < formula->numClauses; i++)
+    ParserState state;
+    initParserState(&state, prefix);
+    return prefixToTree(&state);
+}
+
+// TASK 3: In-order traversal to get infix expression
+// Frame state: 0 = not started, 1 = left side printed, 2 = right side printed
+void inorderTraversal(Node *root)
+{
+    if (root == NULL)
+        return;
+
+    int base = walkStack.top;
+    pushFrame(root, NULL, 0, 0);
+
+    while (walkStack.top > base)
     {
-        bool clauseTrue = false;
+        WalkFrame frame = popFrame();
+        Node *node = frame.node;
 
-        // Clause is true if at least one literal is true
-        for (int j = 0; j < formula->clauses[i].size; j++)
+        if (!isOperator(node->value))
         {
-            int lit = formula->clauses[i].literals[j];
-            int var = abs(lit);
-            bool value = assignment[var];
+            printf("%s", symbolName(node->var));
+            continue;
+        }
 
-            // Check if literal is satisfied
-            if ((lit > 0 && value) || (lit < 0 && !value))
+        if (node->numChildren > 0)
+        {
+            // Frame value is the next operand to print
+            int i = frame.value;
+            if (i == 0)
+                printf("(");
+            else if (i < node->numChildren)
+                printf("%c", node->value);
+
+            if (i < node->numChildren)
             {
-                clauseTrue = true;
-                break;
+                pushFrame(node, NULL, 0, i + 1);
+                pushFrame(node->children[i], NULL, 0, 0);
+            }
+            else
+            {
+                printf(")");
+            }
+            continue;
+        }
+
+        if (frame.state == 0)
+        {
+            printf("(");
+            if (node->value == '~')
+            {
+                printf("~");
+                pushFrame(node, NULL, 2, 0);
+            }
+            else
+            {
+                pushFrame(node, NULL, 1, 0);
+            }
+            if (node->left != NULL)
+                pushFrame(node->left, NULL, 0, 0);
+        }
+        else if (frame.state == 1)
+        {
+            printf("%c", node->value);
+            pushFrame(node, NULL, 2, 0);
+            if (node->right != NULL)
+                pushFrame(node->right, NULL, 0, 0);
+        }
+        else
+        {
+            printf(")");
+        }
+    }
+}
+
+// TASK 4: Calculate height of parse tree
+int calculateHeight(Node *root)
+{
+    if (root == NULL)
+    {
+        return -1;
+    }
+
+    int height = 0;
+    int base = walkStack.top;
+    pushFrame(root, NULL, 0, 0);
+
+    while (walkStack.top > base)
+    {
+        WalkFrame frame = popFrame();
+
+        if (frame.value > height)
+            height = frame.value;
+
+        for (int i = 0; i < frame.node->numChildren; i++)
+            pushFrame(frame.node->children[i], NULL, 0, frame.value + 1);
+
+        // Right child is popped first, keeping the stack short on left-deep chains
+        if (frame.node->left != NULL)
+            pushFrame(frame.node->left, NULL, 0, frame.value + 1);
+        if (frame.node->right != NULL)
+            pushFrame(frame.node->right, NULL, 0, frame.value + 1);
+    }
+
+    return height;
+}
+
+// TASK 5: Evaluate truth value of formula
+int getTruthValue(int variable, TruthAssignment *assignments, int numAssignments)
+{
+    for (int i = 0; i < numAssignments; i++)
+    {
+        if (assignments[i].variable == variable)
+        {
+            return assignments[i].value;
+        }
+    }
+    return -1;
+}
+
+// Frame state: 0 = evaluate left, 1 = left value ready, 2 = right value ready.
+// The left value is kept in the frame while the right side is evaluated.
+int evaluateFormula(Node *root, TruthAssignment *assignments, int numAssignments)
+{
+    if (root == NULL)
+    {
+        return -1;
+    }
+
+    int base = walkStack.top;
+    int ret = -1;
+    pushFrame(root, NULL, 0, 0);
+
+    while (walkStack.top > base)
+    {
+        WalkFrame *frame = &walkStack.frames[walkStack.top - 1];
+        Node *node = frame->node;
+
+        if (node == NULL)
+        {
+            ret = -1;
+            walkStack.top--;
+            continue;
+        }
+
+        if (!isOperator(node->value))
+        {
+            ret = getTruthValue(node->var, assignments, numAssignments);
+            walkStack.top--;
+            continue;
+        }
+
+        if (node->numChildren > 0)
+        {
+            // N-ary fold: state is the next operand, value the result so far.
+            // Stops at the first operand that decides the result.
+            if (frame->state > 0)
+            {
+                if (frame->state == 1)
+                    frame->value = ret;
+                else if (node->value == '+')
+                    frame->value = frame->value || ret;
+                else
+                    frame->value = frame->value && ret;
+
+                bool decided = (node->value == '+') ? frame->value == 1 : frame->value == 0;
+                if (decided || frame->state == node->numChildren)
+                {
+                    ret = frame->value;
+                    walkStack.top--;
+                    continue;
+                }
+            }
+            pushFrame(node->children[frame->state++], NULL, 0, 0);
+            continue;
+        }
+
+        if (frame->state == 0)
+        {
+            frame->state = 1;
+            pushFrame(node->left, NULL, 0, 0);
+            continue;
+        }
+
+        int leftVal, rightVal;
+        if (frame->state == 1)
+        {
+            if (node->right != NULL)
+            {
+                frame->value = ret;
+                frame->state = 2;
+                pushFrame(node->right, NULL, 0, 0);
+                continue;
+            }
+            leftVal = ret;
+            rightVal = 0;
+        }
+        else
+        {
+            leftVal = frame->value;
+            rightVal = ret;
+        }
+        walkStack.top--;
+
+        switch (node->value)
+        {
+        case '~':
+            ret = !leftVal;
+            break;
+        case '+':
+            ret = leftVal || rightVal;
+            break;
+        case '*':
+            ret = leftVal && rightVal;
+            break;
+        case '>':
+            ret = !leftVal || rightVal;
+            break;
+        default:
+            ret = -1;
+        }
+    }
+
+    return ret;
+}
+
+// TASK 6: CNF Conversion Helper Functions
+
+Node *cloneTree(Node *root)
+{
+    if (root == NULL)
+        return NULL;
+
+    Node *copy = NULL;
+    int base = walkStack.top;
+    pushFrame(root, &copy, 0, 0);
+
+    while (walkStack.top > base)
+    {
+        WalkFrame frame = popFrame();
+
+        Node *newNode = createNode(frame.node->value);
+        *frame.slot = newNode;
+
+        if (!isOperator(frame.node->value))
+        {
+            newNode->var = frame.node->var;
+            continue;
+        }
+
+        if (frame.node->numChildren > 0)
+        {
+            allocChildren(newNode, frame.node->numChildren);
+            for (int i = frame.node->numChildren - 1; i >= 0; i--)
+                pushFrame(frame.node->children[i], &newNode->children[i], 0, 0);
+            continue;
+        }
+
+        if (frame.node->left != NULL)
+            pushFrame(frame.node->left, &newNode->left, 0, 0);
+        if (frame.node->right != NULL)
+            pushFrame(frame.node->right, &newNode->right, 0, 0);
+    }
+
+    return copy;
+}
+
+// Append the operands of the op chain rooted at root to *items (grown as
+// needed) in left-to-right order, looking through nested binary and n-ary
+// nodes with the same operator. With release set the nested chain nodes
+// are freed on the way; root itself is kept.
+void gatherOperands(Node *root, char op, Node ***items, int *count, int *capacity, bool release)
+{
+    int base = walkStack.top;
+    pushFrame(root, NULL, 0, 0);
+
+    while (walkStack.top > base)
+    {
+        Node *node = popFrame().node;
+
+        if (node->value != op)
+        {
+            if (*count == *capacity)
+            {
+                *capacity = *capacity > 0 ? *capacity * 2 : 64;
+                *items = (Node **)realloc(*items, *capacity * sizeof(Node *));
+            }
+            (*items)[(*count)++] = node;
+            continue;
+        }
+
+        for (int i = node->numChildren - 1; i >= 0; i--)
+            pushFrame(node->children[i], NULL, 0, 0);
+        if (node->right != NULL)
+            pushFrame(node->right, NULL, 0, 0);
+        if (node->left != NULL)
+            pushFrame(node->left, NULL, 0, 0);
+
+        if (release && node != root)
+        {
+            releaseChildren(node);
+            releaseNode(node);
+        }
+    }
+}
+
+// Join operands with op: a binary node for two, an n-ary node for more
+Node *buildChain(char op, Node **operands, int count)
+{
+    if (count == 1)
+        return operands[0];
+
+    Node *node;
+    if (count == 2)
+    {
+        node = createNode(op);
+        node->left = operands[0];
+        node->right = operands[1];
+    }
+    else
+    {
+        node = createNaryNode(op, count);
+        memcpy(node->children, operands, count * sizeof(Node *));
+    }
+    return node;
+}
+
+// Rewrites (p > q) as (~p + q) in place
+Node *eliminateImplications(Node *root)
+{
+    if (root == NULL)
+        return NULL;
+
+    int base = walkStack.top;
+    pushFrame(root, NULL, 0, 0);
+
+    while (walkStack.top > base)
+    {
+        Node *node = popFrame().node;
+        Node *left = node->left;
+        Node *right = node->right;
+
+        for (int i = node->numChildren - 1; i >= 0; i--)
+            pushFrame(node->children[i], NULL, 0, 0);
+
+        if (node->value == '>')
+        {
+            Node *notNode = createNode('~');
+            notNode->left = left;
+
+            node->value = '+';
+            node->left = notNode;
+        }
+
+        if (right != NULL)
+            pushFrame(right, NULL, 0, 0);
+        if (left != NULL)
+            pushFrame(left, NULL, 0, 0);
+    }
+
+    return root;
+}
+
+// Pushes negations down to the variables. Frames hold the slot of the
+// subtree to rewrite; De Morgan reuses the existing nodes.
+Node *moveNegationsInward(Node *root)
+{
+    Node *result = root;
+    int base = walkStack.top;
+    pushFrame(NULL, &result, 0, 0);
+
+    while (walkStack.top > base)
+    {
+        Node **slot = popFrame().slot;
+        Node *node = *slot;
+
+        if (node == NULL)
+            continue;
+
+        if (node->value != '~')
+        {
+            for (int i = node->numChildren - 1; i >= 0; i--)
+                pushFrame(NULL, &node->children[i], 0, 0);
+            pushFrame(NULL, &node->right, 0, 0);
+            pushFrame(NULL, &node->left, 0, 0);
+            continue;
+        }
+
+        Node *child = node->left;
+
+        if (child != NULL && child->numChildren > 0)
+        {
+            // ~(a * b * c) -> (~a + ~b + ~c), reusing the '~' for the first operand
+            child->value = (child->value == '*') ? '+' : '*';
+            node->left = child->children[0];
+            child->children[0] = node;
+            for (int i = 1; i < child->numChildren; i++)
+            {
+                Node *notNode = createNode('~');
+                notNode->left = child->children[i];
+                child->children[i] = notNode;
             }
+            *slot = child;
+
+            for (int i = child->numChildren - 1; i >= 0; i--)
+                pushFrame(NULL, &child->children[i], 0, 0);
+        }
+        else if (child != NULL && child->value == '~')
+        {
+            *slot = child->left;
+            releaseNode(child);
+            releaseNode(node);
+            pushFrame(NULL, slot, 0, 0);
+        }
+        else if (child != NULL && (child->value == '*' || child->value == '+'))
+        {
+            // ~(a * b) -> (~a + ~b), ~(a + b) -> (~a * ~b)
+            Node *notRight = createNode('~');
+            notRight->left = child->right;
+
+            node->left = child->left;
+
+            child->value = (child->value == '*') ? '+' : '*';
+            child->left = node;
+            child->right = notRight;
+            *slot = child;
+
+            pushFrame(NULL, &child->right, 0, 0);
+            pushFrame(NULL, &child->left, 0, 0);
+        }
+    }
+
+    return result;
+}
+
+// True for an OR that has an n-ary AND operand, or that is itself n-ary
+// with an AND operand. Such ORs are distributed in one step.
+bool needsProduct(Node *node)
+{
+    if (node->value != '+')
+        return false;
+
+    for (int i = 0; i < node->numChildren; i++)
+    {
+        if (node->children[i]->value == '*')
+            return true;
+    }
+    return (node->left != NULL && node->left->value == '*' && node->left->numChildren > 0) ||
+           (node->right != NULL && node->right->value == '*' && node->right->numChildren > 0);
+}
+
+// Distribute an OR whose operands are already in CNF in one step: the
+// result has one clause for every choice of a clause from each operand
+// (first operand varying slowest, as binary distribution orders them).
+// Literals are cloned; the caller frees orNode.
+Node *distributeProduct(Node *orNode)
+{
+    Node **items = NULL;
+    int count = 0, capacity = 0;
+
+    // items: operands, then the clauses of every operand, then their literals
+    gatherOperands(orNode, '+', &items, &count, &capacity, false);
+    int numOperands = count;
+
+    int *clauseStart = (int *)malloc((numOperands + 1) * sizeof(int));
+    for (int i = 0; i < numOperands; i++)
+    {
+        clauseStart[i] = count;
+        gatherOperands(items[i], '*', &items, &count, &capacity, false);
+    }
+    clauseStart[numOperands] = count;
+
+    int numClauses = count - numOperands;
+    int *litStart = (int *)malloc((numClauses + 1) * sizeof(int));
+    for (int j = 0; j < numClauses; j++)
+    {
+        litStart[j] = count;
+        gatherOperands(items[numOperands + j], '+', &items, &count, &capacity, false);
+    }
+    litStart[numClauses] = count;
+
+    long combos = 1;
+    int maxSize = 0;
+    for (int i = 0; i < numOperands; i++)
+    {
+        combos *= clauseStart[i + 1] - clauseStart[i];
+        int widest = 0;
+        for (int c = clauseStart[i]; c < clauseStart[i + 1]; c++)
+        {
+            int size = litStart[c - numOperands + 1] - litStart[c - numOperands];
+            if (size > widest)
+                widest = size;
+        }
+        maxSize += widest;
+    }
+
+    int *pick = (int *)calloc(numOperands + 1, sizeof(int));
+    Node **literals = (Node **)malloc(maxSize * sizeof(Node *));
+    Node *result = (combos > 1) ? createNaryNode('*', (int)combos) : NULL;
+
+    for (long n = 0; n < combos; n++)
+    {
+        int size = 0;
+        for (int i = 0; i < numOperands; i++)
+        {
+            int clause = clauseStart[i] + pick[i] - numOperands;
+            for (int l = litStart[clause]; l < litStart[clause + 1]; l++)
+                literals[size++] = cloneTree(items[l]);
+        }
+
+        Node *clauseNode = buildChain('+', literals, size);
+        if (result == NULL)
+            result = clauseNode;
+        else
+            result->children[n] = clauseNode;
+
+        // Odometer over the clause choices, last operand fastest
+        for (int i = numOperands - 1; i >= 0; i--)
+        {
+            if (++pick[i] < clauseStart[i + 1] - clauseStart[i])
+                break;
+            pick[i] = 0;
+        }
+    }
+
+    free(literals);
+    free(pick);
+    free(litStart);
+    free(clauseStart);
+    free(items);
+    return result;
+}
+
+// Frame state 0 distributes the children first; state 1 then rewrites the
+// node itself, whose children are already in CNF.
+Node *distributeOrOverAnd(Node *root)
+{
+    Node *result = root;
+    int base = walkStack.top;
+    pushFrame(NULL, &result, 0, 0);
+
+    while (walkStack.top > base)
+    {
+        WalkFrame frame = popFrame();
+        Node *node = *frame.slot;
+
+        if (node == NULL)
+            continue;
+
+        if (frame.state == 0)
+        {
+            pushFrame(NULL, frame.slot, 1, 0);
+            for (int i = node->numChildren - 1; i >= 0; i--)
+                pushFrame(NULL, &node->children[i], 0, 0);
+            pushFrame(NULL, &node->right, 0, 0);
+            pushFrame(NULL, &node->left, 0, 0);
+            continue;
         }
 
-        if (!clauseTrue)
-        {
-            return false; // Formula is false
+        if (node->value != '+')
+            continue;
+
+        if (needsProduct(node))
+        {
+            *frame.slot = distributeProduct(node);
+            freeTree(node);
+            continue;
+        }
+
+        if (node->left != NULL && node->left->value == '*')
+        {
+            Node *andNode = node->left;
+            Node *p = andNode->left;
+            Node *q = andNode->right;
+            Node *r = node->right;
+
+            // Build (p + r) and (q + r), reusing the old OR and AND nodes
+            node->left = p;
+            node->right = r;
+
+            Node *or2 = createNode('+');
+            or2->left = q;
+            or2->right = cloneTree(r); // Need separate copy for or2
+
+            andNode->left = node;
+            andNode->right = or2;
+            *frame.slot = andNode;
+
+            pushFrame(NULL, &andNode->right, 1, 0);
+            pushFrame(NULL, &andNode->left, 1, 0);
+        }
+        else if (node->right != NULL && node->right->value == '*')
+        {
+            Node *andNode = node->right;
+            Node *p = node->left;
+            Node *q = andNode->left;
+            Node *r = andNode->right;
+
+            // Build (p + q) and (p + r), reusing the old OR and AND nodes
+            node->left = p;
+            node->right = q;
+
+            Node *or2 = createNode('+');
+            or2->left = cloneTree(p); // Need separate copy for or2
+            or2->right = r;
+
+            andNode->left = node;
+            andNode->right = or2;
+            *frame.slot = andNode;
+
+            pushFrame(NULL, &andNode->right, 1, 0);
+            pushFrame(NULL, &andNode->left, 1, 0);
+        }
+    }
+
+    return result;
+}
+
+Node *convertToCNF(Node *root)
+{
+    if (root == NULL)
+        return NULL;
+
+    root = eliminateImplications(root);
+    root = moveNegationsInward(root);
+    root = distributeOrOverAnd(root);
+
+    return root;
+}
+
+// Merge nested chains of the same associative operator into n-ary nodes:
+// ((a + b) + (c + d)) becomes (a + b + c + d). Works in place; absorbed
+// nodes are released.
+Node *flattenAssociative(Node *root)
+{
+    Node *result = root;
+    Node **operands = NULL;
+    int capacity = 0;
+    int base = walkStack.top;
+    pushFrame(NULL, &result, 0, 0);
+
+    while (walkStack.top > base)
+    {
+        Node **slot = popFrame().slot;
+        Node *node = *slot;
+
+        if (node == NULL)
+            continue;
+
+        if (node->value == '+' || node->value == '*')
+        {
+            int count = 0;
+            gatherOperands(node, node->value, &operands, &count, &capacity, true);
+
+            if (count > 2)
+            {
+                allocChildren(node, count);
+                memcpy(node->children, operands, count * sizeof(Node *));
+                node->left = NULL;
+                node->right = NULL;
+            }
+            else
+            {
+                releaseChildren(node);
+                node->left = operands[0];
+                node->right = operands[1];
+            }
+        }
+
+        for (int i = node->numChildren - 1; i >= 0; i--)
+            pushFrame(NULL, &node->children[i], 0, 0);
+        pushFrame(NULL, &node->right, 0, 0);
+        pushFrame(NULL, &node->left, 0, 0);
+    }
+
+    free(operands);
+    return result;
+}
+
+// ========== HASH-CONSED FORMULA DAG ==========
+
+// Work stacks for the DAG computations on this thread
+_Thread_local DagStack dagStack = {NULL, 0, 0, NULL, 0, 0};
+
+uint64_t hashPointers(uint64_t seed, const void *a, const void *b)
+{
+    uint64_t h = seed * 0x9E3779B97F4A7C15ULL;
+    h ^= (uint64_t)(uintptr_t)a + 0x632BE59BD9B4E019ULL + (h << 6) + (h >> 2);
+    h ^= (uint64_t)(uintptr_t)b + 0x94D049BB133111EBULL + (h << 6) + (h >> 2);
+    h ^= h >> 31;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 29;
+    return h;
+}
+
+HashConsTable *createHashConsTable()
+{
+    HashConsTable *table = (HashConsTable *)malloc(sizeof(HashConsTable));
+    table->capacity = 1024;
+    table->count = 0;
+    table->slots = (Node **)calloc(table->capacity, sizeof(Node *));
+    table->arena = createArena();
+    table->lookups = 0;
+    table->hits = 0;
+    return table;
+}
+
+// Frees the table and every node it created
+void destroyHashConsTable(HashConsTable *table)
+{
+    if (table == NULL)
+        return;
+
+    destroyArena(table->arena);
+    free(table->slots);
+    free(table);
+}
+
+// Symbol ID of a variable leaf, 0 for operators
+int hashConsVar(Node *node)
+{
+    return isOperator(node->value) ? 0 : node->var;
+}
+
+uint64_t hashConsKey(char value, int var, Node *left, Node *right)
+{
+    return hashPointers((unsigned char)value | ((uint64_t)(unsigned)var << 8), left, right);
+}
+
+void growHashConsTable(HashConsTable *table)
+{
+    int oldCapacity = table->capacity;
+    Node **oldSlots = table->slots;
+
+    table->capacity *= 2;
+    table->slots = (Node **)calloc(table->capacity, sizeof(Node *));
+    uint64_t mask = table->capacity - 1;
+
+    for (int i = 0; i < oldCapacity; i++)
+    {
+        Node *node = oldSlots[i];
+        if (node == NULL)
+            continue;
+
+        uint64_t slot = hashConsKey(node->value, hashConsVar(node), node->left, node->right) & mask;
+        while (table->slots[slot] != NULL)
+        {
+            slot = (slot + 1) & mask;
+        }
+        table->slots[slot] = node;
+    }
+    free(oldSlots);
+}
+
+// Return the unique node (value, var, left, right). Children must already
+// be hash-consed nodes of the same table; var is 0 for operators.
+Node *hashConsEntry(HashConsTable *table, char value, int var, Node *left, Node *right)
+{
+    table->lookups++;
+
+    if ((table->count + 1) * 2 > table->capacity)
+        growHashConsTable(table);
+
+    uint64_t mask = table->capacity - 1;
+    uint64_t slot = hashConsKey(value, var, left, right) & mask;
+
+    while (table->slots[slot] != NULL)
+    {
+        Node *node = table->slots[slot];
+        if (node->value == value && node->left == left && node->right == right && hashConsVar(node) == var)
+        {
+            table->hits++;
+            return node;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    NodeArena *previous = setCurrentArena(table->arena);
+    Node *node = createNode(value);
+    setCurrentArena(previous);
+
+    node->left = left;
+    node->right = right;
+    if (var != 0)
+        node->var = var;
+    table->slots[slot] = node;
+    table->count++;
+    return node;
+}
+
+// Unique operator node
+Node *hashConsNode(HashConsTable *table, char value, Node *left, Node *right)
+{
+    return hashConsEntry(table, value, 0, left, right);
+}
+
+void initMemoTable(MemoTable *memo)
+{
+    memo->capacity = 1024;
+    memo->count = 0;
+    memo->entries = (MemoEntry *)calloc(memo->capacity, sizeof(MemoEntry));
+}
+
+void freeMemoTable(MemoTable *memo)
+{
+    free(memo->entries);
+    memo->entries = NULL;
+}
+
+// Find the entry for (key, other, tag); an empty entry means "not found"
+MemoEntry *findMemo(MemoTable *memo, Node *key, Node *other, int tag)
+{
+    uint64_t mask = memo->capacity - 1;
+    uint64_t slot = hashPointers(tag, key, other) & mask;
+
+    while (memo->entries[slot].key != NULL)
+    {
+        MemoEntry *entry = &memo->entries[slot];
+        if (entry->key == key && entry->other == other && entry->tag == tag)
+            return entry;
+        slot = (slot + 1) & mask;
+    }
+    return &memo->entries[slot];
+}
+
+MemoEntry *insertMemo(MemoTable *memo, Node *key, Node *other, int tag)
+{
+    if ((memo->count + 1) * 2 > memo->capacity)
+    {
+        MemoEntry *oldEntries = memo->entries;
+        int oldCapacity = memo->capacity;
+
+        memo->capacity *= 2;
+        memo->entries = (MemoEntry *)calloc(memo->capacity, sizeof(MemoEntry));
+        for (int i = 0; i < oldCapacity; i++)
+        {
+            if (oldEntries[i].key != NULL)
+                *findMemo(memo, oldEntries[i].key, oldEntries[i].other, oldEntries[i].tag) = oldEntries[i];
+        }
+        free(oldEntries);
+    }
+
+    MemoEntry *entry = findMemo(memo, key, other, tag);
+    if (entry->key == NULL)
+    {
+        entry->key = key;
+        entry->other = other;
+        entry->tag = tag;
+        entry->result = NULL;
+        entry->count = 0;
+        memo->count++;
+    }
+    return entry;
+}
+
+void pushDagFrame(int task, Node *a, Node *b, int flag)
+{
+    if (dagStack.top == dagStack.capacity)
+    {
+        dagStack.capacity = dagStack.capacity > 0 ? dagStack.capacity * 2 : 256;
+        dagStack.frames = (DagFrame *)realloc(dagStack.frames, dagStack.capacity * sizeof(DagFrame));
+    }
+
+    DagFrame *frame = &dagStack.frames[dagStack.top++];
+    frame->a = a;
+    frame->b = b;
+    frame->task = task;
+    frame->phase = 0;
+    frame->flag = flag;
+}
+
+void pushDagValue(Node *value)
+{
+    if (dagStack.valueTop == dagStack.valueCapacity)
+    {
+        dagStack.valueCapacity = dagStack.valueCapacity > 0 ? dagStack.valueCapacity * 2 : 256;
+        dagStack.values = (Node **)realloc(dagStack.values, dagStack.valueCapacity * sizeof(Node *));
+    }
+    dagStack.values[dagStack.valueTop++] = value;
+}
+
+Node *popDagValue()
+{
+    return dagStack.values[--dagStack.valueTop];
+}
+
+// DAG computations run by runDagTask
+#define DAG_INTERN 0     // Copy a tree into the unique table
+#define DAG_NNF 1        // Eliminate '>' and push negations inward (flag = negated)
+#define DAG_DISTRIBUTE 2 // Distribute OR over AND
+#define DAG_DISTRIBUTE_OR 3 // CNF of (a + b) where a and b are already CNF
+
+// Operator of a node after NNF under the given polarity
+char nnfOperator(char value, int negated)
+{
+    if (value == '*')
+        return negated ? '+' : '*';
+    // '+' and '>' (which becomes ~a + b)
+    return negated ? '*' : '+';
+}
+
+// Run one DAG computation iteratively. Every result is memoized per node
+// (or node pair), so shared subformulas are processed once.
+Node *runDagTask(HashConsTable *table, MemoTable *memo, int task, Node *a, Node *b, int flag)
+{
+    int base = dagStack.top;
+    int valueBase = dagStack.valueTop;
+    pushDagFrame(task, a, b, flag);
+
+    while (dagStack.top > base)
+    {
+        DagFrame *frame = &dagStack.frames[dagStack.top - 1];
+        Node *node = frame->a;
+
+        if (node == NULL)
+        {
+            pushDagValue(NULL);
+            dagStack.top--;
+            continue;
+        }
+
+        if (frame->task == DAG_INTERN && node->numChildren > 0)
+        {
+            // N-ary nodes are interned as left-deep binary chains
+            int k = node->numChildren;
+            if (frame->phase == 0)
+            {
+                frame->phase = 1;
+                for (int i = k - 1; i >= 0; i--)
+                    pushDagFrame(DAG_INTERN, node->children[i], NULL, 0);
+                continue;
+            }
+            Node **operands = &dagStack.values[dagStack.valueTop - k];
+            Node *chain = operands[0];
+            for (int i = 1; i < k; i++)
+                chain = hashConsNode(table, node->value, chain, operands[i]);
+            dagStack.valueTop -= k;
+            pushDagValue(chain);
+            dagStack.top--;
+            continue;
+        }
+
+        if (frame->task == DAG_INTERN)
+        {
+            if (frame->phase == 0)
+            {
+                frame->phase = 1;
+                pushDagFrame(DAG_INTERN, node->right, NULL, 0);
+                pushDagFrame(DAG_INTERN, node->left, NULL, 0);
+                continue;
+            }
+            Node *right = popDagValue();
+            Node *left = popDagValue();
+            pushDagValue(hashConsEntry(table, node->value, hashConsVar(node), left, right));
+            dagStack.top--;
+            continue;
+        }
+
+        int tag = frame->task * 2 + frame->flag;
+
+        if (frame->phase == 0)
+        {
+            MemoEntry *entry = findMemo(memo, node, frame->b, tag);
+            if (entry->key != NULL)
+            {
+                pushDagValue(entry->result);
+                dagStack.top--;
+                continue;
+            }
+        }
+
+        Node *result = NULL;
+
+        if (frame->task == DAG_NNF)
+        {
+            if (!isOperator(node->value))
+            {
+                result = frame->flag ? hashConsNode(table, '~', node, NULL) : node;
+            }
+            else if (node->value == '~')
+            {
+                // ~x under polarity n is x under polarity !n
+                frame->a = node->left;
+                frame->flag = !frame->flag;
+                continue;
+            }
+            else if (frame->phase == 0)
+            {
+                int negated = frame->flag;
+                int leftNegated = (node->value == '>') ? !negated : negated;
+                frame->phase = 1;
+                pushDagFrame(DAG_NNF, node->right, NULL, negated);
+                pushDagFrame(DAG_NNF, node->left, NULL, leftNegated);
+                continue;
+            }
+            else
+            {
+                Node *right = popDagValue();
+                Node *left = popDagValue();
+                result = hashConsNode(table, nnfOperator(node->value, frame->flag), left, right);
+            }
+        }
+        else if (frame->task == DAG_DISTRIBUTE)
+        {
+            if (node->value != '+' && node->value != '*')
+            {
+                result = node;
+            }
+            else if (frame->phase == 0)
+            {
+                frame->phase = 1;
+                pushDagFrame(DAG_DISTRIBUTE, node->right, NULL, 0);
+                pushDagFrame(DAG_DISTRIBUTE, node->left, NULL, 0);
+                continue;
+            }
+            else if (frame->phase == 1)
+            {
+                Node *right = popDagValue();
+                Node *left = popDagValue();
+                if (node->value == '*')
+                {
+                    result = hashConsNode(table, '*', left, right);
+                }
+                else
+                {
+                    frame->phase = 2;
+                    pushDagFrame(DAG_DISTRIBUTE_OR, left, right, 0);
+                    continue;
+                }
+            }
+            else
+            {
+                result = popDagValue();
+            }
+        }
+        else // DAG_DISTRIBUTE_OR
+        {
+            Node *other = frame->b;
+
+            if (frame->phase == 0)
+            {
+                if (node->value == '*')
+                {
+                    // (p * q) + r -> (p + r) * (q + r)
+                    frame->phase = 1;
+                    pushDagFrame(DAG_DISTRIBUTE_OR, node->right, other, 0);
+                    pushDagFrame(DAG_DISTRIBUTE_OR, node->left, other, 0);
+                    continue;
+                }
+                if (other != NULL && other->value == '*')
+                {
+                    // p + (q * r) -> (p + q) * (p + r)
+                    frame->phase = 1;
+                    pushDagFrame(DAG_DISTRIBUTE_OR, node, other->right, 0);
+                    pushDagFrame(DAG_DISTRIBUTE_OR, node, other->left, 0);
+                    continue;
+                }
+                result = hashConsNode(table, '+', node, other);
+            }
+            else
+            {
+                Node *right = popDagValue();
+                Node *left = popDagValue();
+                result = hashConsNode(table, '*', left, right);
+            }
+        }
+
+        insertMemo(memo, frame->a, frame->b, tag)->result = result;
+        pushDagValue(result);
+        dagStack.top--;
+    }
+
+    Node *result = popDagValue();
+    dagStack.valueTop = valueBase;
+    return result;
+}
+
+// Copy a tree into the unique table; equal subtrees become one node
+Node *internTree(HashConsTable *table, Node *root)
+{
+    return runDagTask(table, NULL, DAG_INTERN, root, NULL, 0);
+}
+
+// CNF conversion on the shared DAG. Produces the same formula as
+// convertToCNF (n-ary nodes come out as binary chains), but distribution
+// reuses subformulas instead of cloning them.
+// The input tree is left untouched; the result belongs to the table.
+Node *convertToCNFShared(HashConsTable *table, Node *root)
+{
+    if (root == NULL)
+        return NULL;
+
+    MemoTable memo;
+    initMemoTable(&memo);
+
+    Node *shared = internTree(table, root);
+    Node *nnf = runDagTask(table, &memo, DAG_NNF, shared, NULL, 0);
+    Node *cnf = runDagTask(table, &memo, DAG_DISTRIBUTE, nnf, NULL, 0);
+
+    freeMemoTable(&memo);
+    return cnf;
+}
+
+// Count distinct nodes and edges of a DAG, and the size of the tree it
+// would expand to without sharing
+void countSharing(Node *root, long *dagNodes, long *dagEdges, double *treeNodes)
+{
+    *dagNodes = 0;
+    *dagEdges = 0;
+    *treeNodes = 0;
+    if (root == NULL)
+        return;
+
+    MemoTable seen;
+    initMemoTable(&seen);
+
+    int base = dagStack.top;
+    pushDagFrame(0, root, NULL, 0);
+
+    while (dagStack.top > base)
+    {
+        DagFrame *frame = &dagStack.frames[dagStack.top - 1];
+        Node *node = frame->a;
+
+        if (frame->phase == 0)
+        {
+            if (findMemo(&seen, node, NULL, 0)->key != NULL)
+            {
+                dagStack.top--;
+                continue;
+            }
+            frame->phase = 1;
+            if (node->right != NULL)
+                pushDagFrame(0, node->right, NULL, 0);
+            if (node->left != NULL)
+                pushDagFrame(0, node->left, NULL, 0);
+            continue;
+        }
+
+        double size = 1;
+        if (node->left != NULL)
+        {
+            size += findMemo(&seen, node->left, NULL, 0)->count;
+            (*dagEdges)++;
+        }
+        if (node->right != NULL)
+        {
+            size += findMemo(&seen, node->right, NULL, 0)->count;
+            (*dagEdges)++;
+        }
+        dagStack.top--;
+
+        insertMemo(&seen, node, NULL, 0)->count = size;
+        (*dagNodes)++;
+    }
+
+    *treeNodes = findMemo(&seen, root, NULL, 0)->count;
+    freeMemoTable(&seen);
+}
+
+// Print how much memory sharing saves for a DAG
+void printSharingReport(Node *root)
+{
+    long dagNodes, dagEdges;
+    double treeNodes;
+    countSharing(root, &dagNodes, &dagEdges, &treeNodes);
+
+    double treeEdges = treeNodes > 0 ? treeNodes - 1 : 0;
+    double dagBytes = (double)dagNodes * sizeof(Node);
+    double treeBytes = treeNodes * sizeof(Node);
+
+    printf("Shared DAG: %ld nodes, %ld edges\n", dagNodes, dagEdges);
+    printf("As a tree:  %.0f nodes, %.0f edges\n", treeNodes, treeEdges);
+    if (treeNodes > 0)
+    {
+        printf("Memory:     %.0f bytes instead of %.0f (%.1f%% saved)\n",
+               dagBytes, treeBytes, 100.0 * (1.0 - dagBytes / treeBytes));
+    }
+}
+
+// ========== FLAT (STRUCT-OF-ARRAYS) TREE ==========
+
+FlatTree *createFlatTree(int capacity)
+{
+    if (capacity < 16)
+        capacity = 16;
+
+    FlatTree *flat = (FlatTree *)malloc(sizeof(FlatTree));
+    flat->count = 0;
+    flat->capacity = capacity;
+    flat->ops = (char *)malloc(capacity);
+    flat->left = (uint32_t *)malloc(capacity * sizeof(uint32_t));
+    flat->right = (uint32_t *)malloc(capacity * sizeof(uint32_t));
+    flat->vars = (int *)malloc(capacity * sizeof(int));
+    flat->links = (uint8_t *)malloc(capacity);
+    flat->scratch = NULL;
+    return flat;
+}
+
+void freeFlatTree(FlatTree *flat)
+{
+    if (flat == NULL)
+        return;
+
+    free(flat->ops);
+    free(flat->left);
+    free(flat->right);
+    free(flat->vars);
+    free(flat->links);
+    free(flat->scratch);
+    free(flat);
+}
+
+uint32_t *flatScratch(FlatTree *flat)
+{
+    if (flat->scratch == NULL)
+        flat->scratch = (uint32_t *)malloc(2 * (size_t)flat->capacity * sizeof(uint32_t));
+    return flat->scratch;
+}
+
+// Convert a pointer tree to the flat form (pre-order). N-ary nodes are
+// stored as left-deep binary chains; every entry after the first is marked
+// in links, so the chain still counts as one level.
+FlatTree *flattenTree(Node *root)
+{
+    FlatTree *flat = createFlatTree(1024);
+    if (root == NULL)
+        return flat;
+
+    // Frame state = parent index, value = 0 for a left child, 1 for a right child
+    int base = walkStack.top;
+    pushFrame(root, NULL, (int)FLAT_NONE, 0);
+
+    while (walkStack.top > base)
+    {
+        WalkFrame frame = popFrame();
+        Node *node = frame.node;
+        int entries = node->numChildren > 0 ? node->numChildren - 1 : 1;
+
+        while (flat->count + entries > flat->capacity)
+        {
+            flat->capacity *= 2;
+            flat->ops = (char *)realloc(flat->ops, flat->capacity);
+            flat->left = (uint32_t *)realloc(flat->left, flat->capacity * sizeof(uint32_t));
+            flat->right = (uint32_t *)realloc(flat->right, flat->capacity * sizeof(uint32_t));
+            flat->vars = (int *)realloc(flat->vars, flat->capacity * sizeof(int));
+            flat->links = (uint8_t *)realloc(flat->links, flat->capacity);
+        }
+
+        uint32_t index = flat->count++;
+        flat->ops[index] = node->value;
+        flat->left[index] = FLAT_NONE;
+        flat->right[index] = FLAT_NONE;
+        flat->vars[index] = hashConsVar(node);
+        flat->links[index] = 0;
+
+        uint32_t parent = (uint32_t)frame.state;
+        if (parent != FLAT_NONE)
+        {
+            if (frame.value == 0)
+                flat->left[parent] = index;
+            else
+                flat->right[parent] = index;
+        }
+
+        if (node->numChildren > 0)
+        {
+            // An n-ary node becomes a left-deep chain of k - 1 binary entries;
+            // in pre-order the chain comes first, then the operands in order
+            int k = node->numChildren;
+            for (int j = 1; j < k - 1; j++)
+            {
+                uint32_t link = flat->count++;
+                flat->ops[link] = node->value;
+                flat->left[link - 1] = link;
+                flat->right[link] = FLAT_NONE;
+                flat->vars[link] = 0;
+                flat->links[link] = 1;
+            }
+            uint32_t last = flat->count - 1;
+            flat->left[last] = FLAT_NONE;
+
+            for (int i = k - 1; i >= 1; i--)
+                pushFrame(node->children[i], NULL, (int)(last - (i - 1)), 1);
+            pushFrame(node->children[0], NULL, (int)last, 0);
+            continue;
+        }
+
+        if (node->right != NULL)
+            pushFrame(node->right, NULL, (int)index, 1);
+        if (node->left != NULL)
+            pushFrame(node->left, NULL, (int)index, 0);
+    }
+
+    return flat;
+}
+
+// Convert the flat form back to a pointer tree
+Node *unflattenTree(FlatTree *flat)
+{
+    if (flat->count == 0)
+        return NULL;
+
+    Node **nodes = (Node **)malloc(flat->count * sizeof(Node *));
+    for (int i = 0; i < flat->count; i++)
+    {
+        nodes[i] = createNode(flat->ops[i]);
+        if (!isOperator(flat->ops[i]))
+            nodes[i]->var = flat->vars[i];
+    }
+    for (int i = 0; i < flat->count; i++)
+    {
+        if (flat->left[i] != FLAT_NONE)
+            nodes[i]->left = nodes[flat->left[i]];
+        if (flat->right[i] != FLAT_NONE)
+            nodes[i]->right = nodes[flat->right[i]];
+    }
+
+    Node *root = nodes[0];
+    free(nodes);
+    return root;
+}
+
+// Same result as evaluateFormula. Children always follow their parent, so
+// one backward sweep evaluates every node after its children.
+int evaluateFlat(FlatTree *flat, TruthAssignment *assignments, int numAssignments)
+{
+    if (flat->count == 0)
+        return -1;
+
+    int *values = (int *)flatScratch(flat);
+
+    for (int i = flat->count - 1; i >= 0; i--)
+    {
+        char op = flat->ops[i];
+
+        if (!isOperator(op))
+        {
+            values[i] = getTruthValue(flat->vars[i], assignments, numAssignments);
+            continue;
+        }
+
+        int leftVal = (flat->left[i] != FLAT_NONE) ? values[flat->left[i]] : -1;
+        int rightVal = (flat->right[i] != FLAT_NONE) ? values[flat->right[i]] : 0;
+
+        switch (op)
+        {
+        case '~':
+            values[i] = !leftVal;
+            break;
+        case '+':
+            values[i] = leftVal || rightVal;
+            break;
+        case '*':
+            values[i] = leftVal && rightVal;
+            break;
+        default: // '>'
+            values[i] = !leftVal || rightVal;
+            break;
+        }
+    }
+
+    return values[0];
+}
+
+// Same result as calculateHeight: one forward sweep assigning depths. A
+// chain link takes its parent's depth, so the operands of an n-ary node
+// all sit one level below it.
+int calculateFlatHeight(FlatTree *flat)
+{
+    if (flat->count == 0)
+        return -1;
+
+    uint32_t *depth = flatScratch(flat);
+    uint32_t height = 0;
+    depth[0] = 0;
+
+    for (int i = 0; i < flat->count; i++)
+    {
+        uint32_t d = depth[i];
+        if (d > height)
+            height = d;
+        if (flat->left[i] != FLAT_NONE)
+            depth[flat->left[i]] = d + 1 - flat->links[flat->left[i]];
+        if (flat->right[i] != FLAT_NONE)
+            depth[flat->right[i]] = d + 1;
+    }
+
+    return (int)height;
+}
+
+// Same output as treeToPrefix: the nodes are already stored in prefix order
+void flatToPrefix(FlatTree *flat, char *result, int *resultIndex)
+{
+    for (int i = 0; i < flat->count; i++)
+    {
+        if (isOperator(flat->ops[i]))
+        {
+            result[(*resultIndex)++] = flat->ops[i];
+        }
+        else
+        {
+            const char *name = symbolName(flat->vars[i]);
+            while (*name != '\0')
+                result[(*resultIndex)++] = *name++;
+        }
+        result[(*resultIndex)++] = ' ';
+    }
+}
+
+// Write the infix form of a pointer tree (same text as inorderTraversal)
+void treeToInfix(Node *root, char *result, int *resultIndex)
+{
+    if (root == NULL)
+        return;
+
+    int base = walkStack.top;
+    pushFrame(root, NULL, 0, 0);
+
+    while (walkStack.top > base)
+    {
+        WalkFrame frame = popFrame();
+        Node *node = frame.node;
+
+        if (!isOperator(node->value))
+        {
+            const char *name = symbolName(node->var);
+            while (*name != '\0')
+                result[(*resultIndex)++] = *name++;
+            continue;
+        }
+
+        if (node->numChildren > 0)
+        {
+            int i = frame.value;
+            if (i == 0)
+                result[(*resultIndex)++] = '(';
+            else if (i < node->numChildren)
+                result[(*resultIndex)++] = node->value;
+
+            if (i < node->numChildren)
+            {
+                pushFrame(node, NULL, 0, i + 1);
+                pushFrame(node->children[i], NULL, 0, 0);
+            }
+            else
+            {
+                result[(*resultIndex)++] = ')';
+            }
+            continue;
+        }
+
+        if (frame.state == 0)
+        {
+            result[(*resultIndex)++] = '(';
+            if (node->value == '~')
+            {
+                result[(*resultIndex)++] = '~';
+                pushFrame(node, NULL, 2, 0);
+            }
+            else
+            {
+                pushFrame(node, NULL, 1, 0);
+            }
+            if (node->left != NULL)
+                pushFrame(node->left, NULL, 0, 0);
+        }
+        else if (frame.state == 1)
+        {
+            result[(*resultIndex)++] = node->value;
+            pushFrame(node, NULL, 2, 0);
+            if (node->right != NULL)
+                pushFrame(node->right, NULL, 0, 0);
+        }
+        else
+        {
+            result[(*resultIndex)++] = ')';
+        }
+    }
+}
+
+// Flat version of treeToInfix. Stack entries are node index * 4 + state.
+void flatToInfix(FlatTree *flat, char *result, int *resultIndex)
+{
+    if (flat->count == 0)
+        return;
+
+    uint32_t *stack = flatScratch(flat);
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0)
+    {
+        uint32_t entry = stack[--top];
+        uint32_t i = entry >> 2;
+        uint32_t state = entry & 3;
+        char op = flat->ops[i];
+
+        if (!isOperator(op))
+        {
+            const char *name = symbolName(flat->vars[i]);
+            while (*name != '\0')
+                result[(*resultIndex)++] = *name++;
+            continue;
+        }
+
+        if (state == 0)
+        {
+            result[(*resultIndex)++] = '(';
+            if (op == '~')
+            {
+                result[(*resultIndex)++] = '~';
+                stack[top++] = (i << 2) | 2;
+            }
+            else
+            {
+                stack[top++] = (i << 2) | 1;
+            }
+            if (flat->left[i] != FLAT_NONE)
+                stack[top++] = flat->left[i] << 2;
+        }
+        else if (state == 1)
+        {
+            result[(*resultIndex)++] = op;
+            stack[top++] = (i << 2) | 2;
+            if (flat->right[i] != FLAT_NONE)
+                stack[top++] = flat->right[i] << 2;
+        }
+        else
+        {
+            result[(*resultIndex)++] = ')';
+        }
+    }
+}
+
+// ========== BYTECODE EVALUATOR ==========
+
+// Append one instruction and track the deepest stack it can reach
+void emitInstruction(Program *program, int opcode, int operand, int stackChange, int *depth)
+{
+    if (program->length == program->capacity)
+    {
+        program->capacity *= 2;
+        program->code = (uint32_t *)realloc(program->code, program->capacity * sizeof(uint32_t));
+    }
+    program->code[program->length++] = (uint32_t)opcode | ((uint32_t)operand << 8);
+
+    *depth += stackChange;
+    if (*depth > program->maxStack)
+        program->maxStack = *depth;
+}
+
+// Compile a parse tree to postfix bytecode. Slots follow the variable order
+// of collectVariables, so slot i is program->slotVars[i].
+Program *compileFormula(Node *root)
+{
+    Program *program = (Program *)malloc(sizeof(Program));
+    program->length = 0;
+    program->capacity = 64;
+    program->code = (uint32_t *)malloc(program->capacity * sizeof(uint32_t));
+    program->maxStack = 0;
+    program->slotVars = collectVariables(root, &program->numSlots);
+
+    // Symbol ID -> slot, for the variables of this formula
+    int maxVar = 0;
+    for (int i = 0; i < program->numSlots; i++)
+    {
+        if (program->slotVars[i] > maxVar)
+            maxVar = program->slotVars[i];
+    }
+    int *slotOf = (int *)malloc((maxVar + 1) * sizeof(int));
+    for (int i = 0; i < program->numSlots; i++)
+    {
+        slotOf[program->slotVars[i]] = i;
+    }
+
+    // Post-order walk: state 0 schedules the operands, state 1 emits the
+    // operator. An n-ary node combines each child into the running value as
+    // soon as it is on the stack, so wide nodes do not deepen the stack;
+    // its state counts the children emitted so far.
+    int depth = 0;
+    if (root != NULL)
+    {
+        int base = walkStack.top;
+        pushFrame(root, NULL, 0, 0);
+
+        while (walkStack.top > base)
+        {
+            WalkFrame frame = popFrame();
+            Node *node = frame.node;
+
+            if (!isOperator(node->value))
+            {
+                emitInstruction(program, OP_LOAD, slotOf[node->var], 1, &depth);
+                continue;
+            }
+
+            int k = node->numChildren;
+            if (k > 0)
+            {
+                int done = frame.state;
+                if (done >= 2)
+                    emitInstruction(program, node->value == '+' ? OP_OR : OP_AND, 0, -1, &depth);
+                if (done < k)
+                {
+                    pushFrame(node, NULL, done + 1, 0);
+                    pushFrame(node->children[done], NULL, 0, 0);
+                }
+                continue;
+            }
+
+            if (frame.state == 0)
+            {
+                pushFrame(node, NULL, 1, 0);
+                if (node->right != NULL)
+                    pushFrame(node->right, NULL, 0, 0);
+                if (node->left != NULL)
+                    pushFrame(node->left, NULL, 0, 0);
+                continue;
+            }
+
+            switch (node->value)
+            {
+            case '~':
+                emitInstruction(program, OP_NOT, 0, 0, &depth);
+                break;
+            case '+':
+                emitInstruction(program, OP_OR, 0, -1, &depth);
+                break;
+            case '*':
+                emitInstruction(program, OP_AND, 0, -1, &depth);
+                break;
+            default: // '>'
+                emitInstruction(program, OP_IMPLIES, 0, -1, &depth);
+                break;
+            }
+        }
+    }
+
+    free(slotOf);
+    program->stack = (unsigned char *)malloc(program->maxStack + 1);
+    program->wordStack = (uint64_t *)malloc((program->maxStack + 1) * sizeof(uint64_t));
+    return program;
+}
+
+// Run the program with values[slot] (0 or 1) for every slot. Gives the
+// same result as evaluateFormula with the same assignment.
+int evaluateProgram(Program *program, const unsigned char *values)
+{
+    if (program->length == 0)
+        return -1;
+
+    const uint32_t *code = program->code;
+    unsigned char *stack = program->stack;
+    int top = 0;
+
+    for (int pc = 0; pc < program->length; pc++)
+    {
+        uint32_t instruction = code[pc];
+        uint32_t operand = instruction >> 8;
+
+        switch (instruction & 0xFF)
+        {
+        case OP_LOAD:
+            stack[top++] = values[operand];
+            break;
+        case OP_NOT:
+            stack[top - 1] = !stack[top - 1];
+            break;
+        case OP_OR:
+            top--;
+            stack[top - 1] = stack[top - 1] | stack[top];
+            break;
+        case OP_AND:
+            top--;
+            stack[top - 1] = stack[top - 1] & stack[top];
+            break;
+        case OP_IMPLIES:
+            top--;
+            stack[top - 1] = (!stack[top - 1]) | stack[top];
+            break;
+        }
+    }
+
+    return stack[0];
+}
+
+// Run the program on 64 rows at once. Bit j of values[slot] is the value
+// of the slot in lane j, and bit j of the result is the formula in lane j.
+// stack needs maxStack + 1 words, so threads can share one program.
+uint64_t evaluateWordsOnStack(Program *program, const uint64_t *values, uint64_t *stack)
+{
+    if (program->length == 0)
+        return 0;
+
+    const uint32_t *code = program->code;
+    int top = 0;
+
+    for (int pc = 0; pc < program->length; pc++)
+    {
+        uint32_t instruction = code[pc];
+        uint32_t operand = instruction >> 8;
+
+        switch (instruction & 0xFF)
+        {
+        case OP_LOAD:
+            stack[top++] = values[operand];
+            break;
+        case OP_NOT:
+            stack[top - 1] = ~stack[top - 1];
+            break;
+        case OP_OR:
+            top--;
+            stack[top - 1] |= stack[top];
+            break;
+        case OP_AND:
+            top--;
+            stack[top - 1] &= stack[top];
+            break;
+        case OP_IMPLIES:
+            top--;
+            stack[top - 1] = ~stack[top - 1] | stack[top];
+            break;
+        }
+    }
+
+    return stack[0];
+}
+
+// Run the program on 64 rows at once with the program's own stack
+uint64_t evaluateProgramWords(Program *program, const uint64_t *values)
+{
+    return evaluateWordsOnStack(program, values, program->wordStack);
+}
+
+// Lane masks for width blocks of 64 rows starting at firstRow (a multiple
+// of 64). Word j of slot i is values[i * width + j] and covers rows
+// firstRow + 64j onwards; row r gives slot i the value of bit i of r.
+void setRowMasks(uint64_t *values, int numSlots, long long firstRow, int width)
+{
+    static const uint64_t laneBits[6] = {
+        0xAAAAAAAAAAAAAAAAull, 0xCCCCCCCCCCCCCCCCull, 0xF0F0F0F0F0F0F0F0ull,
+        0xFF00FF00FF00FF00ull, 0xFFFF0000FFFF0000ull, 0xFFFFFFFF00000000ull};
+
+    for (int i = 0; i < numSlots; i++)
+    {
+        for (int j = 0; j < width; j++)
+        {
+            long long row = firstRow + 64LL * j;
+            if (i < 6)
+                values[i * width + j] = laneBits[i];
+            else
+                values[i * width + j] = ((row >> i) & 1) ? ~(uint64_t)0 : 0;
+        }
+    }
+}
+
+// ========== SIMD TRUTH TABLES ==========
+
+// Instruction set levels, each a vector of SIMD_WIDTH words (64 rows each)
+#define SIMD_SCALAR 0
+#define SIMD_SSE2 1
+#define SIMD_AVX2 2
+#define SIMD_AVX512 3
+
+static const int simdWidth[4] = {1, 2, 4, 8};
+static const char *simdNames[4] = {"scalar", "SSE2", "AVX2", "AVX-512"};
+
+// Run the program on one vector of lanes per slot. The vector type is a GCC
+// vector extension, so the bitwise operators compile to the instructions of
+// the target ISA. values holds width words per slot; stack is 64-byte aligned.
+#define DEFINE_SIMD_KERNEL(name, isa, bytes)                                         \
+    __attribute__((target(isa))) void name(Program *program, const uint64_t *values, \
+                                           void *stackSpace, uint64_t *out)          \
+    {                                                                                \
+        typedef uint64_t Vector __attribute__((vector_size(bytes)));                \
+        const Vector *lanes = (const Vector *)values;                               \
+        Vector *stack = (Vector *)stackSpace;                                       \
+        int top = 0;                                                                 \
+                                                                                     \
+        for (int pc = 0; pc < program->length; pc++)                                 \
+        {                                                                            \
+            uint32_t instruction = program->code[pc];                                \
+            uint32_t operand = instruction >> 8;                                     \
+                                                                                     \
+            switch (instruction & 0xFF)                                              \
+            {                                                                        \
+            case OP_LOAD:                                                            \
+                stack[top++] = lanes[operand];                                       \
+                break;                                                               \
+            case OP_NOT:                                                             \
+                stack[top - 1] = ~stack[top - 1];                                    \
+                break;                                                               \
+            case OP_OR:                                                              \
+                top--;                                                               \
+                stack[top - 1] |= stack[top];                                        \
+                break;                                                               \
+            case OP_AND:                                                             \
+                top--;                                                               \
+                stack[top - 1] &= stack[top];                                        \
+                break;                                                               \
+            case OP_IMPLIES:                                                         \
+                top--;                                                               \
+                stack[top - 1] = ~stack[top - 1] | stack[top];                       \
+                break;                                                               \
+            }                                                                        \
+        }                                                                            \
+        memcpy(out, &stack[0], bytes); /* table words are only 8-byte aligned */     \
+    }
+
+#ifdef HAVE_X86_SIMD
+DEFINE_SIMD_KERNEL(evaluateProgramSSE2, "sse2", 16)
+DEFINE_SIMD_KERNEL(evaluateProgramAVX2, "avx2", 32)
+DEFINE_SIMD_KERNEL(evaluateProgramAVX512, "avx512f", 64)
+#endif
+
+// Best level this CPU (and OS) supports, detected once
+int detectSimdLevel()
+{
+    static int level = -1;
+    if (level >= 0)
+        return level;
+
+    level = SIMD_SCALAR;
+#ifdef HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        level = SIMD_AVX512;
+    else if (__builtin_cpu_supports("avx2"))
+        level = SIMD_AVX2;
+    else if (__builtin_cpu_supports("sse2"))
+        level = SIMD_SSE2;
+#endif
+    return level;
+}
+
+const char *simdLevelName(int level)
+{
+    return (level >= 0 && level <= SIMD_AVX512) ? simdNames[level] : "?";
+}
+
+// Usable level for a table of the given size: the CPU's best if asked for
+// more, and the word path for tables smaller than one vector
+int resolveSimdLevel(Program *program, int level)
+{
+    long long words = ((1LL << program->numSlots) + 63) / 64;
+
+    if (level > detectSimdLevel())
+        level = detectSimdLevel();
+    if (words < simdWidth[level] || program->length == 0)
+        level = SIMD_SCALAR;
+    return level;
+}
+
+// Fill table words [firstWord, lastWord) at a level from resolveSimdLevel.
+// Both bounds must be multiples of the level's width.
+void fillTruthTableRange(Program *program, int level, uint64_t *table, long long firstWord, long long lastWord)
+{
+    int width = simdWidth[level];
+    size_t valueBytes = ((program->numSlots + 1) * width * sizeof(uint64_t) + 63) & ~(size_t)63;
+    uint64_t *values = (uint64_t *)aligned_alloc(64, valueBytes);
+    void *stack = aligned_alloc(64, (program->maxStack + 1) * 64);
+
+    for (long long w = firstWord; w < lastWord; w += width)
+    {
+        setRowMasks(values, program->numSlots, w * 64, width);
+        switch (level)
+        {
+#ifdef HAVE_X86_SIMD
+        case SIMD_SSE2:
+            evaluateProgramSSE2(program, values, stack, table + w);
+            break;
+        case SIMD_AVX2:
+            evaluateProgramAVX2(program, values, stack, table + w);
+            break;
+        case SIMD_AVX512:
+            evaluateProgramAVX512(program, values, stack, table + w);
+            break;
+#endif
+        default:
+            table[w] = evaluateWordsOnStack(program, values, (uint64_t *)stack);
+            break;
+        }
+    }
+
+    free(values);
+    free(stack);
+}
+
+// Evaluate every row of the truth table with the given instruction set.
+// Bit (r % 64) of word r / 64 is the result for row r; lanes past the last
+// row are zero. Levels above what the CPU supports fall back to the best one.
+uint64_t *computeTruthTableSimd(Program *program, int level)
+{
+    long long rows = 1LL << program->numSlots;
+    long long words = (rows + 63) / 64;
+    uint64_t *table = (uint64_t *)malloc(words * sizeof(uint64_t));
+
+    fillTruthTableRange(program, resolveSimdLevel(program, level), table, 0, words);
+    if (rows < 64)
+        table[0] &= ((uint64_t)1 << rows) - 1;
+    return table;
+}
+
+// Evaluate every row of the truth table with the best available kernel
+uint64_t *computeTruthTable(Program *program)
+{
+    return computeTruthTableSimd(program, detectSimdLevel());
+}
+
+// ========== PARALLEL TRUTH TABLES ==========
+
+#define TRUTH_CHUNK_WORDS 1024 // 65536 rows per chunk, a multiple of every SIMD width
+
+// Number of online processors, at least 1
+int availableCores()
+{
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    return cores > 0 ? (int)cores : 1;
+}
+
+// Add the true rows of table words [firstWord, lastWord) to summary.
+// Words must be visited in increasing order for the same summary.
+void summarizeTruthWords(const uint64_t *table, long long firstWord, long long lastWord, TruthTableSummary *summary)
+{
+    for (long long w = firstWord; w < lastWord; w++)
+    {
+        uint64_t word = table[w];
+        if (word == 0)
+            continue;
+
+        summary->satisfying += __builtin_popcountll(word);
+        if (summary->firstModel < 0)
+            summary->firstModel = w * 64 + __builtin_ctzll(word);
+        summary->lastModel = w * 64 + 63 - __builtin_clzll(word);
+    }
+}
+
+void *truthTableWorker(void *arg)
+{
+    TruthTableWorker *worker = (TruthTableWorker *)arg;
+    TruthTableJob *job = worker->job;
+
+    while (1)
+    {
+        long long chunk = __atomic_fetch_add(&job->nextChunk, 1, __ATOMIC_RELAXED);
+        if (chunk >= job->numChunks)
+            break;
+
+        long long first = chunk * TRUTH_CHUNK_WORDS;
+        long long last = first + TRUTH_CHUNK_WORDS;
+        if (last > job->words)
+            last = job->words;
+
+        fillTruthTableRange(job->program, job->level, job->table, first, last);
+        if (job->rows < 64)
+            job->table[0] &= ((uint64_t)1 << job->rows) - 1;
+        summarizeTruthWords(job->table, first, last, &worker->summary);
+
+        if (job->chunkDone != NULL)
+        {
+            pthread_mutex_lock(&job->lock);
+            job->chunkDone[chunk] = 1;
+            pthread_cond_broadcast(&job->chunkReady);
+            pthread_mutex_unlock(&job->lock);
+        }
+    }
+    return NULL;
+}
+
+// Evaluate the whole truth table on numThreads threads, in chunks handed
+// out in row order. Returns the packed table (as computeTruthTable) and
+// fills summary. When sink is not NULL the calling thread passes every row
+// to it in order as soon as its chunk is done, while the others compute.
+uint64_t *enumerateTruthTable(Program *program, int numThreads, TruthRowSink sink, void *context,
+                              TruthTableSummary *summary)
+{
+    TruthTableJob job;
+    job.program = program;
+    job.level = resolveSimdLevel(program, detectSimdLevel());
+    job.rows = 1LL << program->numSlots;
+    job.words = (job.rows + 63) / 64;
+    job.table = (uint64_t *)malloc(job.words * sizeof(uint64_t));
+    job.numChunks = (job.words + TRUTH_CHUNK_WORDS - 1) / TRUTH_CHUNK_WORDS;
+    job.nextChunk = 0;
+    job.chunkDone = sink != NULL ? (unsigned char *)calloc(job.numChunks, 1) : NULL;
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_cond_init(&job.chunkReady, NULL);
+
+    if (numThreads < 1)
+        numThreads = 1;
+    if (numThreads > job.numChunks)
+        numThreads = (int)job.numChunks;
+
+    TruthTableWorker *workers = (TruthTableWorker *)malloc(numThreads * sizeof(TruthTableWorker));
+    for (int i = 0; i < numThreads; i++)
+    {
+        workers[i].job = &job;
+        workers[i].summary.satisfying = 0;
+        workers[i].summary.firstModel = -1;
+        workers[i].summary.lastModel = -1;
+    }
+
+    // Without a sink the calling thread is worker 0; with one it only writes
+    pthread_t *threads = (pthread_t *)malloc(numThreads * sizeof(pthread_t));
+    int started = 0;
+    for (int i = (sink != NULL ? 0 : 1); i < numThreads; i++)
+    {
+        if (pthread_create(&threads[started], NULL, truthTableWorker, &workers[i]) == 0)
+            started++;
+    }
+
+    if (sink == NULL || started == 0)
+        truthTableWorker(&workers[0]);
+
+    if (sink != NULL)
+    {
+        for (long long chunk = 0; chunk < job.numChunks; chunk++)
+        {
+            pthread_mutex_lock(&job.lock);
+            while (!job.chunkDone[chunk])
+                pthread_cond_wait(&job.chunkReady, &job.lock);
+            pthread_mutex_unlock(&job.lock);
+
+            long long firstRow = chunk * TRUTH_CHUNK_WORDS * 64;
+            long long lastRow = firstRow + TRUTH_CHUNK_WORDS * 64;
+            if (lastRow > job.rows)
+                lastRow = job.rows;
+            for (long long row = firstRow; row < lastRow; row++)
+                sink(context, row, (job.table[row >> 6] >> (row & 63)) & 1);
+        }
+    }
+
+    for (int i = 0; i < started; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    // Workers take chunks in increasing order, so the lowest first and the
+    // highest last model over all workers are the table's
+    summary->satisfying = 0;
+    summary->firstModel = -1;
+    summary->lastModel = -1;
+    for (int i = 0; i < numThreads; i++)
+    {
+        TruthTableSummary *part = &workers[i].summary;
+        summary->satisfying += part->satisfying;
+        if (part->firstModel >= 0 && (summary->firstModel < 0 || part->firstModel < summary->firstModel))
+            summary->firstModel = part->firstModel;
+        if (part->lastModel > summary->lastModel)
+            summary->lastModel = part->lastModel;
+    }
+
+    pthread_mutex_destroy(&job.lock);
+    pthread_cond_destroy(&job.chunkReady);
+    free(job.chunkDone);
+    free(threads);
+    free(workers);
+    return job.table;
+}
+
+// Free a compiled program
+void freeProgram(Program *program)
+{
+    if (program == NULL)
+        return;
+
+    free(program->code);
+    free(program->slotVars);
+    free(program->stack);
+    free(program->wordStack);
+    free(program);
+}
+
+// ========== GRAY-CODE TRUTH TABLES ==========
+
+// Copy a tree into an incremental circuit with every variable false
+IncrementalCircuit *buildIncrementalCircuit(Node *root)
+{
+    IncrementalCircuit *circuit = (IncrementalCircuit *)malloc(sizeof(IncrementalCircuit));
+    int n = countNodes(root);
+    circuit->numNodes = n;
+    circuit->op = (char *)malloc(n + 1);
+    circuit->parent = (int *)malloc((n + 1) * sizeof(int));
+    circuit->childStart = (int *)calloc(n + 2, sizeof(int));
+    circuit->children = (int *)malloc((n + 1) * sizeof(int));
+    circuit->trueChildren = (int *)calloc(n + 1, sizeof(int));
+    circuit->value = (unsigned char *)calloc(n + 1, 1);
+    circuit->slotVars = collectVariables(root, &circuit->numSlots);
+    circuit->leafStart = (int *)calloc(circuit->numSlots + 2, sizeof(int));
+    circuit->leaves = (int *)malloc((n + 1) * sizeof(int));
+    circuit->updates = 0;
+
+    int maxVar = 0;
+    for (int i = 0; i < circuit->numSlots; i++)
+    {
+        if (circuit->slotVars[i] > maxVar)
+            maxVar = circuit->slotVars[i];
+    }
+    int *slotOf = (int *)malloc((maxVar + 1) * sizeof(int));
+    for (int i = 0; i < circuit->numSlots; i++)
+    {
+        slotOf[circuit->slotVars[i]] = i;
+    }
+
+    // Pre-order numbering; a frame's value is the parent's number. Children
+    // are pushed in reverse so they are numbered left to right.
+    int *leafSlot = (int *)malloc((n + 1) * sizeof(int));
+    int next = 0;
+    if (root != NULL)
+    {
+        int base = walkStack.top;
+        pushFrame(root, NULL, 0, -1);
+
+        while (walkStack.top > base)
+        {
+            WalkFrame frame = popFrame();
+            Node *node = frame.node;
+            int index = next++;
+
+            circuit->parent[index] = frame.value;
+            if (frame.value >= 0)
+                circuit->childStart[frame.value + 1]++;
+
+            if (!isOperator(node->value))
+            {
+                circuit->op[index] = 0;
+                leafSlot[index] = slotOf[node->var];
+                circuit->leafStart[leafSlot[index] + 1]++;
+                continue;
+            }
+
+            circuit->op[index] = node->value;
+            for (int i = node->numChildren - 1; i >= 0; i--)
+                pushFrame(node->children[i], NULL, 0, index);
+            if (node->right != NULL)
+                pushFrame(node->right, NULL, 0, index);
+            if (node->left != NULL)
+                pushFrame(node->left, NULL, 0, index);
+        }
+    }
+
+    // Counts to offsets, then place children and leaves in node order
+    for (int i = 0; i < n; i++)
+        circuit->childStart[i + 1] += circuit->childStart[i];
+    for (int s = 0; s < circuit->numSlots; s++)
+        circuit->leafStart[s + 1] += circuit->leafStart[s];
+
+    int *childFill = (int *)malloc((n + 1) * sizeof(int));
+    int *leafFill = (int *)malloc((circuit->numSlots + 1) * sizeof(int));
+    memcpy(childFill, circuit->childStart, (n + 1) * sizeof(int));
+    memcpy(leafFill, circuit->leafStart, (circuit->numSlots + 1) * sizeof(int));
+    for (int i = 0; i < n; i++)
+    {
+        if (circuit->parent[i] >= 0)
+            circuit->children[childFill[circuit->parent[i]]++] = i;
+        if (circuit->op[i] == 0)
+            circuit->leaves[leafFill[leafSlot[i]]++] = i;
+    }
+
+    // Values for the all-false row, children before parents
+    for (int i = n - 1; i >= 0; i--)
+    {
+        int first = circuit->childStart[i];
+        int count = circuit->childStart[i + 1] - first;
+        for (int c = first; c < first + count; c++)
+            circuit->trueChildren[i] += circuit->value[circuit->children[c]];
+
+        switch (circuit->op[i])
+        {
+        case 0:
+            circuit->value[i] = 0;
+            break;
+        case '~':
+            circuit->value[i] = !circuit->value[circuit->children[first]];
+            break;
+        case '+':
+            circuit->value[i] = circuit->trueChildren[i] > 0;
+            break;
+        case '*':
+            circuit->value[i] = circuit->trueChildren[i] == count;
+            break;
+        default: // '>'
+            circuit->value[i] = (!circuit->value[circuit->children[first]]) |
+                                circuit->value[circuit->children[first + 1]];
+            break;
+        }
+    }
+
+    free(childFill);
+    free(leafFill);
+    free(leafSlot);
+    free(slotOf);
+    return circuit;
+}
+
+// Flip one variable and recompute the nodes above its leaves. Each path
+// stops at the first node whose value does not change.
+void flipCircuitVariable(IncrementalCircuit *circuit, int slot)
+{
+    for (int k = circuit->leafStart[slot]; k < circuit->leafStart[slot + 1]; k++)
+    {
+        int node = circuit->leaves[k];
+        circuit->value[node] ^= 1;
+        circuit->updates++;
+
+        int parent = circuit->parent[node];
+        while (parent >= 0)
+        {
+            int first = circuit->childStart[parent];
+            unsigned char now;
+            switch (circuit->op[parent])
+            {
+            case '~':
+                now = !circuit->value[node];
+                break;
+            case '+':
+                circuit->trueChildren[parent] += circuit->value[node] ? 1 : -1;
+                now = circuit->trueChildren[parent] > 0;
+                break;
+            case '*':
+                circuit->trueChildren[parent] += circuit->value[node] ? 1 : -1;
+                now = circuit->trueChildren[parent] == circuit->childStart[parent + 1] - first;
+                break;
+            default: // '>'
+                now = (!circuit->value[circuit->children[first]]) | circuit->value[circuit->children[first + 1]];
+                break;
+            }
+            circuit->updates++;
+
+            if (now == circuit->value[parent])
+                break;
+            circuit->value[parent] = now;
+            node = parent;
+            parent = circuit->parent[node];
+        }
+    }
+}
+
+// Walk every row in Gray-code order, flipping one variable per step.
+// Returns the packed table (as computeTruthTable); when sink is not NULL
+// it also gets every row in the order visited.
+uint64_t *grayCodeTruthTable(IncrementalCircuit *circuit, TruthRowSink sink, void *context)
+{
+    long long rows = 1LL << circuit->numSlots;
+    uint64_t *table = (uint64_t *)calloc((rows + 63) / 64, sizeof(uint64_t));
+
+    for (long long i = 0; i < rows; i++)
+    {
+        if (i > 0)
+            flipCircuitVariable(circuit, __builtin_ctzll(i));
+
+        long long row = i ^ (i >> 1);
+        int result = circuit->numNodes > 0 ? circuit->value[0] : 0;
+        if (result)
+            table[row >> 6] |= (uint64_t)1 << (row & 63);
+        if (sink != NULL)
+            sink(context, row, result);
+    }
+    return table;
+}
+
+// Free an incremental circuit
+void freeIncrementalCircuit(IncrementalCircuit *circuit)
+{
+    if (circuit == NULL)
+        return;
+
+    free(circuit->op);
+    free(circuit->parent);
+    free(circuit->childStart);
+    free(circuit->children);
+    free(circuit->trueChildren);
+    free(circuit->value);
+    free(circuit->slotVars);
+    free(circuit->leafStart);
+    free(circuit->leaves);
+    free(circuit);
+}
+
+// ========== COFACTOR TRUTH TABLES ==========
+
+#define COFACTOR_LEAF_LEVEL 12 // Blocks of 4096 rows go to the SIMD kernels
+
+// Substitute value for slot in source and fold the constants, writing the
+// smaller program to result (code capacity at least source->length).
+// Returns 0 or 1 when the whole formula became constant, -1 otherwise.
+int cofactorProgram(Program *source, int slot, int value, Program *result, CofactorEntry *entries)
+{
+    uint32_t *out = result->code;
+    int length = 0;
+    int top = 0;
+
+    for (int pc = 0; pc < source->length; pc++)
+    {
+        uint32_t instruction = source->code[pc];
+        int opcode = instruction & 0xFF;
+        int operand = instruction >> 8;
+
+        if (opcode == OP_LOAD)
+        {
+            entries[top].start = length;
+            if (operand == slot)
+            {
+                entries[top++].constant = value;
+            }
+            else
+            {
+                entries[top++].constant = -1;
+                out[length++] = instruction;
+            }
+            continue;
+        }
+        if (opcode == OP_NOT)
+        {
+            if (entries[top - 1].constant >= 0)
+                entries[top - 1].constant ^= 1;
+            else
+                out[length++] = instruction;
+            continue;
+        }
+
+        // Operands with code are the last ones emitted, so their code is
+        // one contiguous run from the first of them to the end
+        int count = 2;
+        top -= count;
+        CofactorEntry *args = &entries[top];
+        int start = length;
+        int live = 0;
+        for (int i = 0; i < count; i++)
+        {
+            if (args[i].constant < 0)
+            {
+                if (live++ == 0)
+                    start = args[i].start;
+            }
+        }
+
+        CofactorEntry folded = {-1, start};
+        if (opcode == OP_IMPLIES)
+        {
+            if (args[0].constant == 0 || args[1].constant == 1)
+                folded.constant = 1;
+            else if (args[0].constant == 1)
+                folded.constant = args[1].constant; // The right operand as is
+            else if (args[1].constant == 0)
+                out[length++] = OP_NOT;
+            else
+                out[length++] = instruction;
+        }
+        else
+        {
+            int decisive = opcode == OP_OR ? 1 : 0;
+            bool decided = false;
+            for (int i = 0; i < count; i++)
+            {
+                if (args[i].constant == decisive)
+                    decided = true;
+            }
+
+            if (decided)
+                folded.constant = decisive;
+            else if (live == 0)
+                folded.constant = !decisive;
+            else if (live == 2)
+                out[length++] = instruction;
+        }
+
+        // A constant result drops the code of its operands
+        if (folded.constant >= 0)
+            length = start;
+        entries[top++] = folded;
+    }
+
+    result->length = length;
+    result->maxStack = source->maxStack;
+    result->numSlots = source->numSlots;
+    return length == 0 ? entries[0].constant : -1;
+}
+
+// Fill the 2^level rows from firstRow by splitting on the top free variable
+// (slot level - 1). A cofactor that folds to a constant fills its whole
+// block at once; small blocks are evaluated by the SIMD kernels.
+void cofactorFill(Program *program, int level, long long firstRow, uint64_t *table, Program *scratch,
+                  CofactorEntry *entries, int simdLevel, CofactorStats *stats)
+{
+    if (level <= COFACTOR_LEAF_LEVEL)
+    {
+        fillTruthTableRange(program, simdLevel, table, firstRow >> 6, (firstRow + (1LL << level)) >> 6);
+        stats->evaluatedRows += 1LL << level;
+        return;
+    }
+
+    Program *child = &scratch[level - 1];
+    for (int value = 0; value <= 1; value++)
+    {
+        long long childFirst = firstRow + ((long long)value << (level - 1));
+        int constant = cofactorProgram(program, level - 1, value, child, entries);
+        if (constant >= 0)
+        {
+            memset(table + (childFirst >> 6), constant ? 0xFF : 0, (1LL << (level - 1)) / 8);
+            stats->constantBlocks++;
+            stats->constantRows += 1LL << (level - 1);
+        }
+        else
+        {
+            cofactorFill(child, level - 1, childFirst, table, scratch, entries, simdLevel, stats);
+        }
+    }
+}
+
+// Truth table by cofactor splitting, in the layout of computeTruthTable.
+// Formulas that fold to constants once their top variables are fixed
+// cost a memset per block instead of an evaluation per row.
+uint64_t *cofactorTruthTable(Program *program, CofactorStats *stats)
+{
+    int k = program->numSlots;
+    long long rows = 1LL << k;
+    stats->constantBlocks = 0;
+    stats->constantRows = 0;
+    stats->evaluatedRows = 0;
+
+    if (k <= COFACTOR_LEAF_LEVEL || program->length == 0)
+    {
+        stats->evaluatedRows = rows;
+        return computeTruthTable(program);
+    }
+
+    // One scratch program per level, reused by both cofactors of the level
+    uint64_t *table = (uint64_t *)malloc((rows / 64) * sizeof(uint64_t));
+    Program *scratch = (Program *)calloc(k, sizeof(Program));
+    for (int i = 0; i < k; i++)
+    {
+        scratch[i].code = (uint32_t *)malloc(program->length * sizeof(uint32_t));
+        scratch[i].capacity = program->length;
+    }
+    CofactorEntry *entries = (CofactorEntry *)malloc((program->maxStack + 1) * sizeof(CofactorEntry));
+
+    cofactorFill(program, k, 0, table, scratch, entries, resolveSimdLevel(program, detectSimdLevel()), stats);
+
+    for (int i = 0; i < k; i++)
+    {
+        free(scratch[i].code);
+    }
+    free(scratch);
+    free(entries);
+    return table;
+}
+
+// ========== TRUTH TABLE OUTPUT ==========
+
+#define TABLE_WRITER_BUFFER (1 << 20)
+
+// Start a writer for rows of varCount columns; add files with addTableSink
+TableWriter *createTableWriter(int varCount)
+{
+    TableWriter *writer = (TableWriter *)malloc(sizeof(TableWriter));
+    writer->numFiles = 0;
+    writer->varCount = varCount;
+    writer->capacity = TABLE_WRITER_BUFFER;
+    writer->buffer = (char *)malloc(writer->capacity);
+    writer->used = 0;
+    return writer;
+}
+
+// Send the writer's output to file as well (up to TABLE_MAX_SINKS files)
+bool addTableSink(TableWriter *writer, FILE *file)
+{
+    if (writer->numFiles == TABLE_MAX_SINKS)
+        return false;
+    writer->files[writer->numFiles++] = file;
+    return true;
+}
+
+// Write the buffered text to every file
+void flushTableWriter(TableWriter *writer)
+{
+    for (int i = 0; i < writer->numFiles; i++)
+    {
+        fwrite(writer->buffer, 1, writer->used, writer->files[i]);
+        fflush(writer->files[i]);
+    }
+    writer->used = 0;
+}
+
+// Append length bytes, flushing first when they do not fit
+void writeTableText(TableWriter *writer, const char *text, size_t length)
+{
+    if (writer->used + length > writer->capacity)
+    {
+        flushTableWriter(writer);
+        if (length > writer->capacity)
+        {
+            writer->capacity = length;
+            writer->buffer = (char *)realloc(writer->buffer, writer->capacity);
+        }
+    }
+    memcpy(writer->buffer + writer->used, text, length);
+    writer->used += length;
+}
+
+// Write the heading and column names, as printTruthTableHeader does
+void writeTableHeader(TableWriter *writer, Node *tree, int *vars, int varCount)
+{
+    size_t longest = 1;
+    for (int i = 0; i < varCount; i++)
+    {
+        size_t length = strlen(symbolName(vars[i]));
+        if (length > longest)
+            longest = length;
+    }
+
+    char *infix = (char *)malloc((size_t)countNodes(tree) * (longest + 3) + 1);
+    int length = 0;
+    treeToInfix(tree, infix, &length);
+
+    writeTableText(writer, "\nTruth Table for: ", 18);
+    writeTableText(writer, infix, length);
+    writeTableText(writer, "\n\n", 2);
+    for (int i = 0; i < varCount; i++)
+    {
+        writeTableText(writer, symbolName(vars[i]), strlen(symbolName(vars[i])));
+        writeTableText(writer, " ", 1);
+    }
+    writeTableText(writer, "Result\n", 7);
+    for (int i = 0; i < varCount + 6; i++)
+    {
+        writeTableText(writer, "-", 1);
+    }
+    writeTableText(writer, "\n", 1);
+    free(infix);
+}
+
+// Row sink for enumerateTruthTable: format the row once into the buffer
+void writeTableRow(void *context, long long row, int result)
+{
+    TableWriter *writer = (TableWriter *)context;
+    size_t length = 2 * (size_t)writer->varCount + 2;
+    if (writer->used + length > writer->capacity)
+        flushTableWriter(writer);
+
+    char *out = writer->buffer + writer->used;
+    for (int i = 0; i < writer->varCount; i++)
+    {
+        *out++ = '0' + ((row >> i) & 1);
+        *out++ = ' ';
+    }
+    *out++ = result ? 'T' : 'F';
+    *out++ = '\n';
+    writer->used += length;
+}
+
+// Flush and free the writer. The files stay open.
+void destroyTableWriter(TableWriter *writer)
+{
+    flushTableWriter(writer);
+    free(writer->buffer);
+    free(writer);
+}
+
+// A 32- or 64-bit field in little-endian byte order, or back from it
+uint32_t littleEndian32(uint32_t value)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return __builtin_bswap32(value);
+#else
+    return value;
+#endif
+}
+
+uint64_t littleEndian64(uint64_t value)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return __builtin_bswap64(value);
+#else
+    return value;
+#endif
+}
+
+// Save a packed table (layout of computeTruthTable) as a binary .ttb file
+bool saveTruthTableBinary(const char *filename, const uint64_t *table, int *vars, int varCount)
+{
+    FILE *file = fopen(filename, "wb");
+    if (file == NULL)
+    {
+        printf("Error: Cannot open file %s\n", filename);
+        return false;
+    }
+
+    uint64_t numRows = 1ULL << varCount;
+    uint64_t namesLength = 0;
+    for (int i = 0; i < varCount; i++)
+    {
+        namesLength += strlen(symbolName(vars[i])) + 1;
+    }
+    uint64_t dataOffset = (sizeof(TruthTableFileHeader) + namesLength + 7) & ~(uint64_t)7;
+
+    TruthTableFileHeader header;
+    memcpy(header.magic, "TTB1", 4);
+    header.numVars = littleEndian32(varCount);
+    header.numRows = littleEndian64(numRows);
+    header.dataOffset = littleEndian64(dataOffset);
+
+    fwrite(&header, sizeof(header), 1, file);
+    for (int i = 0; i < varCount; i++)
+    {
+        fwrite(symbolName(vars[i]), 1, strlen(symbolName(vars[i])) + 1, file);
+    }
+    static const char padding[8] = {0};
+    fwrite(padding, 1, dataOffset - sizeof(header) - namesLength, file);
+
+    // Row r is bit r % 64 of word r / 64, so the words' little-endian
+    // bytes are in row order
+    uint64_t bytes = (numRows + 7) / 8;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    for (uint64_t w = 0; w * 8 < bytes; w++)
+    {
+        uint64_t word = littleEndian64(table[w]);
+        fwrite(&word, 1, bytes - w * 8 < 8 ? bytes - w * 8 : 8, file);
+    }
+#else
+    fwrite(table, 1, bytes, file);
+#endif
+
+    bool ok = !ferror(file);
+    fclose(file);
+    return ok;
+}
+
+// Open a whole file for reading. With mmap the pages come in on demand,
+// and sequential asks the kernel to read ahead; without it the file is
+// read into one buffer. Prints the error and returns false on failure.
+bool openFileView(const char *filename, FileView *view, bool sequential)
+{
+    view->data = NULL;
+    view->size = 0;
+    view->mapped = false;
+
+#ifdef HAVE_MMAP
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+    {
+        printf("Error: Cannot open file %s\n", filename);
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0)
+    {
+        printf("Error: Cannot read file %s\n", filename);
+        close(fd);
+        return false;
+    }
+    view->size = info.st_size;
+    if (view->size == 0)
+    {
+        close(fd);
+        return true; // Nothing to map
+    }
+
+    void *map = mmap(NULL, view->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        printf("Error: Cannot map file %s\n", filename);
+        return false;
+    }
+#ifdef MADV_SEQUENTIAL
+    // Only a hint; reading works the same if it is refused
+    if (sequential)
+        madvise(map, view->size, MADV_SEQUENTIAL);
+#endif
+    view->data = (const char *)map;
+    view->mapped = true;
+    return true;
+#else
+    (void)sequential;
+    FILE *file = fopen(filename, "rb");
+    if (file == NULL)
+    {
+        printf("Error: Cannot open file %s\n", filename);
+        return false;
+    }
+
+    char *buffer = NULL;
+    long size = -1;
+    if (fseek(file, 0, SEEK_END) == 0 && (size = ftell(file)) >= 0 && fseek(file, 0, SEEK_SET) == 0)
+    {
+        buffer = (char *)malloc(size > 0 ? size : 1);
+        if (buffer != NULL && fread(buffer, 1, size, file) != (size_t)size)
+        {
+            free(buffer);
+            buffer = NULL;
+        }
+    }
+    fclose(file);
+    if (buffer == NULL)
+    {
+        printf("Error: Cannot read file %s\n", filename);
+        return false;
+    }
+    view->data = buffer;
+    view->size = size;
+    return true;
+#endif
+}
+
+// Release what openFileView took
+void closeFileView(FileView *view)
+{
+#ifdef HAVE_MMAP
+    if (view->mapped)
+    {
+        munmap((void *)view->data, view->size);
+        return;
+    }
+#endif
+    free((void *)view->data);
+}
+
+// Map a binary truth table for O(1) row lookups. Returns NULL on error.
+TruthTableFile *openTruthTableFile(const char *filename)
+{
+    FileView view;
+    if (!openFileView(filename, &view, false))
+        return NULL;
+
+    if (view.size < sizeof(TruthTableFileHeader))
+    {
+        printf("Error: %s is not a binary truth table\n", filename);
+        closeFileView(&view);
+        return NULL;
+    }
+
+    // Copy the header out in host byte order
+    TruthTableFileHeader header;
+    memcpy(&header, view.data, sizeof(header));
+    header.numVars = littleEndian32(header.numVars);
+    header.numRows = littleEndian64(header.numRows);
+    header.dataOffset = littleEndian64(header.dataOffset);
+
+    size_t size = view.size;
+    if (memcmp(header.magic, "TTB1", 4) != 0 || header.numVars > 62 || header.numRows != 1ULL << header.numVars ||
+        header.dataOffset < sizeof(TruthTableFileHeader) || header.dataOffset % 8 != 0 || header.dataOffset > size ||
+        (size - header.dataOffset) < (header.numRows + 7) / 8)
+    {
+        printf("Error: %s is not a valid binary truth table\n", filename);
+        closeFileView(&view);
+        return NULL;
+    }
+
+    TruthTableFile *file = (TruthTableFile *)malloc(sizeof(TruthTableFile));
+    file->view = view;
+    file->header = header;
+    file->bits = (const unsigned char *)view.data + header.dataOffset;
+    file->varNames = (const char **)malloc((header.numVars + 1) * sizeof(char *));
+
+    // Names must all end before the row bits
+    const char *name = view.data + sizeof(TruthTableFileHeader);
+    const char *end = (const char *)file->bits;
+    for (uint32_t i = 0; i < header.numVars; i++)
+    {
+        const char *nul = memchr(name, '\0', end - name);
+        file->varNames[i] = nul != NULL ? name : "?";
+        name = nul != NULL ? nul + 1 : end;
+    }
+    return file;
+}
+
+// Result for one row, or -1 when the row is out of range
+int truthTableFileRow(TruthTableFile *file, uint64_t row)
+{
+    if (row >= file->header.numRows)
+        return -1;
+    return (file->bits[row >> 3] >> (row & 7)) & 1;
+}
+
+// Unmap and free a binary truth table
+void closeTruthTableFile(TruthTableFile *file)
+{
+    if (file == NULL)
+        return;
+
+    closeFileView(&file->view);
+    free(file->varNames);
+    free(file);
+}
+
+// TASK 7: Validity Check
+
+// Number of nodes in a subtree (bounds the literal count of a clause)
+int countNodes(Node *root)
+{
+    if (root == NULL)
+        return 0;
+
+    int count = 0;
+    int base = walkStack.top;
+    pushFrame(root, NULL, 0, 0);
+
+    while (walkStack.top > base)
+    {
+        Node *node = popFrame().node;
+        count++;
+
+        for (int i = 0; i < node->numChildren; i++)
+            pushFrame(node->children[i], NULL, 0, 0);
+        if (node->right != NULL)
+            pushFrame(node->right, NULL, 0, 0);
+        if (node->left != NULL)
+            pushFrame(node->left, NULL, 0, 0);
+    }
+    return count;
+}
+
+void extractClauses(Node *root, Node **clauses, int *count, int maxClauses)
+{
+    if (root == NULL)
+        return;
+
+    int base = walkStack.top;
+    pushFrame(root, NULL, 0, 0);
+
+    while (walkStack.top > base)
+    {
+        Node *node = popFrame().node;
+
+        if (*count >= maxClauses)
+        {
+            walkStack.top = base;
+            break;
+        }
+
+        if (node->value == '*')
+        {
+            for (int i = node->numChildren - 1; i >= 0; i--)
+                pushFrame(node->children[i], NULL, 0, 0);
+            if (node->right != NULL)
+                pushFrame(node->right, NULL, 0, 0);
+            if (node->left != NULL)
+                pushFrame(node->left, NULL, 0, 0);
+        }
+        else
+        {
+            clauses[(*count)++] = node;
+        }
+    }
+}
+
+// Number of clauses of a CNF tree: the operands of its top-level AND chain
+int countClauses(Node *root)
+{
+    if (root == NULL)
+        return 0;
+
+    int count = 0;
+    int base = walkStack.top;
+    pushFrame(root, NULL, 0, 0);
+
+    while (walkStack.top > base)
+    {
+        Node *node = popFrame().node;
+        if (node->value != '*')
+        {
+            count++;
+            continue;
+        }
+        for (int i = node->numChildren - 1; i >= 0; i--)
+            pushFrame(node->children[i], NULL, 0, 0);
+        if (node->right != NULL)
+            pushFrame(node->right, NULL, 0, 0);
+        if (node->left != NULL)
+            pushFrame(node->left, NULL, 0, 0);
+    }
+    return count;
+}
+
+void initTautologyChecker(TautologyChecker *checker)
+{
+    checker->capacity = symbols.count + 1;
+    checker->stamp = (unsigned int *)calloc(checker->capacity, sizeof(unsigned int));
+    checker->generation = 0;
+    checker->literalCapacity = 64;
+    checker->literals = (int *)malloc(checker->literalCapacity * sizeof(int));
+}
+
+void freeTautologyChecker(TautologyChecker *checker)
+{
+    free(checker->stamp);
+    free(checker->literals);
+}
+
+// Collect the literals of a clause node as signed symbol IDs into
+// checker->literals; returns how many there are
+int clauseLiterals(TautologyChecker *checker, Node *clause)
+{
+    int count = 0;
+    int base = walkStack.top;
+    pushFrame(clause, NULL, 0, 0);
+
+    while (walkStack.top > base)
+    {
+        Node *node = popFrame().node;
+        int literal = 0;
+        if (!isOperator(node->value))
+            literal = node->var;
+        else if (node->value == '~' && node->left != NULL && !isOperator(node->left->value))
+            literal = -node->left->var;
+        else
+        {
+            for (int i = node->numChildren - 1; i >= 0; i--)
+                pushFrame(node->children[i], NULL, 0, 0);
+            if (node->right != NULL)
+                pushFrame(node->right, NULL, 0, 0);
+            if (node->left != NULL)
+                pushFrame(node->left, NULL, 0, 0);
+            continue;
+        }
+
+        if (count == checker->literalCapacity)
+        {
+            checker->literalCapacity *= 2;
+            checker->literals = (int *)realloc(checker->literals, checker->literalCapacity * sizeof(int));
+        }
+        checker->literals[count++] = literal;
+    }
+    return count;
+}
+
+// Does a clause contain some literal and its complement? One pass over
+// the literals, checking each against the stamp of its symbol.
+bool isTautology(TautologyChecker *checker, const int *literals, int count)
+{
+    if (++checker->generation >= 0x7FFFFFFF)
+    {
+        memset(checker->stamp, 0, checker->capacity * sizeof(unsigned int));
+        checker->generation = 1;
+    }
+    unsigned int current = checker->generation << 1;
+
+    for (int i = 0; i < count; i++)
+    {
+        int id = abs(literals[i]);
+        unsigned int sign = literals[i] < 0;
+        if (id >= checker->capacity)
+        {
+            // Names interned after the checker was set up
+            int capacity = checker->capacity;
+            while (capacity <= id)
+                capacity *= 2;
+            checker->stamp = (unsigned int *)realloc(checker->stamp, capacity * sizeof(unsigned int));
+            memset(checker->stamp + checker->capacity, 0, (capacity - checker->capacity) * sizeof(unsigned int));
+            checker->capacity = capacity;
+        }
+
+        unsigned int seen = checker->stamp[id];
+        if ((seen & ~1u) == current && (seen & 1u) != sign)
+            return true;
+        checker->stamp[id] = current | sign;
+    }
+    return false;
+}
+
+#define VALIDITY_CHUNK 256
+
+void *validityWorker(void *arg)
+{
+    ValidityJob *job = (ValidityJob *)arg;
+    TautologyChecker checker;
+    initTautologyChecker(&checker);
+
+    while (1)
+    {
+        int start = __atomic_fetch_add(&job->nextClause, VALIDITY_CHUNK, __ATOMIC_RELAXED);
+        // Chunks after a clause already found invalid cannot change the answer
+        if (start >= job->numClauses || start > __atomic_load_n(&job->firstInvalid, __ATOMIC_RELAXED))
+            break;
+
+        int end = start + VALIDITY_CHUNK < job->numClauses ? start + VALIDITY_CHUNK : job->numClauses;
+        for (int i = start; i < end; i++)
+        {
+            int count = clauseLiterals(&checker, job->clauses[i]);
+            if (!isTautology(&checker, checker.literals, count))
+            {
+                int seen = __atomic_load_n(&job->firstInvalid, __ATOMIC_RELAXED);
+                while (i < seen &&
+                       !__atomic_compare_exchange_n(&job->firstInvalid, &seen, i, false, __ATOMIC_RELAXED,
+                                                    __ATOMIC_RELAXED))
+                    ;
+                break;
+            }
+        }
+    }
+
+    freeTautologyChecker(&checker);
+    return NULL;
+}
+
+// Thread entry for the extra validity workers
+void *validityThread(void *arg)
+{
+    validityWorker(arg);
+    releaseWorkStack();
+    return NULL;
+}
+
+// Index of the first clause of a CNF tree that is not a tautology, or -1
+// when every clause is one (the formula is valid). With numThreads > 1 the
+// clauses are checked in chunks on that many threads; a chunk that starts
+// after an invalid clause already found is skipped.
+int findNonTautologicalClause(Node *cnfRoot, int numThreads)
+{
+    int numClauses = countClauses(cnfRoot);
+    Node **clauses = (Node **)malloc((numClauses > 0 ? numClauses : 1) * sizeof(Node *));
+    int clauseCount = 0;
+    extractClauses(cnfRoot, clauses, &clauseCount, numClauses);
+
+    ValidityJob job = {clauses, clauseCount, 0, INT_MAX};
+    if (numThreads < 1)
+        numThreads = 1;
+
+    pthread_t *threads = (pthread_t *)malloc(numThreads * sizeof(pthread_t));
+    int started = 0;
+    for (int i = 1; i < numThreads; i++)
+    {
+        if (pthread_create(&threads[started], NULL, validityThread, &job) == 0)
+            started++;
+    }
+
+    // The calling thread works too
+    validityWorker(&job);
+
+    for (int i = 0; i < started; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    free(clauses);
+    return job.firstInvalid == INT_MAX ? -1 : job.firstInvalid;
+}
+
+// A CNF formula is valid when every clause holds some literal and its
+// complement. Stops at the first clause that does not.
+bool isValidCNF(Node *cnfRoot)
+{
+    if (cnfRoot == NULL)
+        return false;
+
+    TautologyChecker checker;
+    initTautologyChecker(&checker);
+    bool valid = true;
+    int base = walkStack.top;
+    pushFrame(cnfRoot, NULL, 0, 0);
+
+    while (walkStack.top > base)
+    {
+        Node *node = popFrame().node;
+        if (node->value == '*')
+        {
+            for (int i = node->numChildren - 1; i >= 0; i--)
+                pushFrame(node->children[i], NULL, 0, 0);
+            if (node->right != NULL)
+                pushFrame(node->right, NULL, 0, 0);
+            if (node->left != NULL)
+                pushFrame(node->left, NULL, 0, 0);
+            continue;
+        }
+
+        int count = clauseLiterals(&checker, node);
+        if (!isTautology(&checker, checker.literals, count))
+        {
+            valid = false;
+            walkStack.top = base;
+        }
+    }
+
+    freeTautologyChecker(&checker);
+    return valid;
+}
+
+// ========== DIMACS FORMAT SUPPORT ==========
+
+#define DIMACS_CLAUSE_LIST 0 // One Clause per clause, each pointing at its literals
+#define DIMACS_FLAT 1        // Literals back to back; clause i spans clauseStart[i]..clauseStart[i + 1]
+#define DIMACS_FLAT_PACKED 2 // Flat, each literal stored unsigned as 2 * var + (negative ? 1 : 0)
+
+// Create an empty DIMACS formula in the given layout
+DIMACSFormula *createDIMACS(int layout)
+{
+    DIMACSFormula *formula = (DIMACSFormula *)malloc(sizeof(DIMACSFormula));
+    formula->clauses = NULL;
+    formula->literals = NULL;
+    formula->clauseStart = NULL;
+    formula->layout = layout;
+    formula->numClauses = 0;
+    formula->numVars = 0;
+    return formula;
+}
+
+// Number of literals in clause i, whatever the layout
+int dimacsClauseSize(const DIMACSFormula *formula, int i)
+{
+    if (formula->layout == DIMACS_CLAUSE_LIST)
+        return formula->clauses[i].size;
+    return (int)(formula->clauseStart[i + 1] - formula->clauseStart[i]);
+}
+
+// Literal j of clause i as a signed DIMACS literal, whatever the layout
+int dimacsLiteral(const DIMACSFormula *formula, int i, int j)
+{
+    if (formula->layout == DIMACS_CLAUSE_LIST)
+        return formula->clauses[i].literals[j];
+    size_t k = formula->clauseStart[i] + j;
+    if (formula->layout == DIMACS_FLAT)
+        return formula->literals[k];
+    unsigned int code = ((const unsigned int *)formula->literals)[k];
+    return code & 1 ? -(int)(code >> 1) : (int)(code >> 1);
+}
+
+// Give a formula whose literals sit in formula->literals, with clause i
+// starting at clauseStart[i], its final layout. The clause list layout
+// points each Clause into the block; the packed layout recodes the
+// literals in place.
+void finishDIMACSLayout(DIMACSFormula *formula, size_t *clauseStart, int layout)
+{
+    formula->layout = layout;
+    if (layout == DIMACS_CLAUSE_LIST)
+    {
+        formula->clauses = (Clause *)malloc((formula->numClauses > 0 ? formula->numClauses : 1) * sizeof(Clause));
+        for (int i = 0; i < formula->numClauses; i++)
+        {
+            formula->clauses[i].literals = formula->literals + clauseStart[i];
+            formula->clauses[i].size = (int)(clauseStart[i + 1] - clauseStart[i]);
+        }
+        free(clauseStart);
+        return;
+    }
+
+    formula->clauseStart = clauseStart;
+    if (layout == DIMACS_FLAT_PACKED)
+    {
+        unsigned int *codes = (unsigned int *)formula->literals;
+        for (size_t k = 0; k < clauseStart[formula->numClauses]; k++)
+        {
+            int lit = formula->literals[k];
+            codes[k] = lit < 0 ? 2u * (unsigned int)-lit + 1 : 2u * (unsigned int)lit;
+        }
+    }
+}
+
+// Convert a formula to a flat layout in place: one literal block plus
+// clause offsets, freeing the per-clause storage
+void flattenDIMACS(DIMACSFormula *formula, int layout)
+{
+    if (formula->layout != DIMACS_CLAUSE_LIST || layout == DIMACS_CLAUSE_LIST)
+        return;
+
+    size_t *clauseStart = (size_t *)malloc((formula->numClauses + 1) * sizeof(size_t));
+    clauseStart[0] = 0;
+    for (int i = 0; i < formula->numClauses; i++)
+        clauseStart[i + 1] = clauseStart[i] + formula->clauses[i].size;
+
+    int *literals = (int *)malloc((clauseStart[formula->numClauses] > 0 ? clauseStart[formula->numClauses] : 1) *
+                                  sizeof(int));
+    for (int i = 0; i < formula->numClauses; i++)
+    {
+        memcpy(literals + clauseStart[i], formula->clauses[i].literals, formula->clauses[i].size * sizeof(int));
+        if (formula->literals == NULL)
+            free(formula->clauses[i].literals);
+    }
+    free(formula->literals);
+    free(formula->clauses);
+    formula->clauses = NULL;
+    formula->literals = literals;
+    finishDIMACSLayout(formula, clauseStart, layout);
+}
+
+// Heap bytes a formula occupies. Separately allocated clauses are costed
+// the way glibc lays out small blocks: an 8-byte header, 16-byte
+// rounding, 32 bytes at least.
+size_t dimacsBytes(const DIMACSFormula *formula)
+{
+    size_t bytes = sizeof(DIMACSFormula);
+    if (formula->layout != DIMACS_CLAUSE_LIST)
+        return bytes + (formula->numClauses + 1) * sizeof(size_t) +
+               formula->clauseStart[formula->numClauses] * sizeof(int);
+
+    bytes += formula->numClauses * sizeof(Clause);
+    for (int i = 0; i < formula->numClauses; i++)
+    {
+        size_t size = formula->clauses[i].size * sizeof(int);
+        if (formula->literals != NULL)
+            bytes += size;
+        else
+        {
+            size_t chunk = (size + 8 + 15) & ~(size_t)15;
+            bytes += chunk < 32 ? 32 : chunk;
+        }
+    }
+    return bytes;
+}
+
+// Get or create the DIMACS variable of a symbol (O(1))
+int getIntVar(int symbol)
+{
+    if (symbol >= varMap.symbolCapacity)
+    {
+        int capacity = varMap.symbolCapacity > 0 ? varMap.symbolCapacity : 64;
+        while (capacity <= symbol)
+            capacity *= 2;
+        varMap.intOfSymbol = (int *)realloc(varMap.intOfSymbol, capacity * sizeof(int));
+        memset(varMap.intOfSymbol + varMap.symbolCapacity, 0, (capacity - varMap.symbolCapacity) * sizeof(int));
+        varMap.symbolCapacity = capacity;
+    }
+
+    if (varMap.intOfSymbol[symbol] != 0)
+    {
+        return varMap.intOfSymbol[symbol];
+    }
+
+    // Create new mapping
+    int intVar = varMap.size + 1;
+    if (intVar >= varMap.intCapacity)
+    {
+        varMap.intCapacity = varMap.intCapacity > 0 ? varMap.intCapacity * 2 : 64;
+        varMap.symbolOfInt = (int *)realloc(varMap.symbolOfInt, varMap.intCapacity * sizeof(int));
+    }
+    varMap.symbolOfInt[intVar] = symbol;
+    varMap.intOfSymbol[symbol] = intVar;
+    varMap.size = intVar;
+
+    return intVar;
+}
+
+// Get the variable name of a DIMACS variable (O(1))
+const char *getVarName(int intVar)
+{
+    if (intVar < 1 || intVar > varMap.size)
+        return "?";
+    return symbolName(varMap.symbolOfInt[intVar]);
+}
+
+// Forget the current numbering (O(number of mapped variables))
+void resetVarMapping()
+{
+    for (int i = 1; i <= varMap.size; i++)
+    {
+        varMap.intOfSymbol[varMap.symbolOfInt[i]] = 0;
+    }
+    varMap.size = 0;
+    varMap.firstAux = 0;
+}
+
+void freeVarMapping()
+{
+    free(varMap.intOfSymbol);
+    free(varMap.symbolOfInt);
+    memset(&varMap, 0, sizeof(varMap));
+}
+
+// Extract literals from a clause (OR expression)
+void extractLiterals(Node *clause, int *literals, int *litCount)
+{
+    if (clause == NULL)
+        return;
+
+    int base = walkStack.top;
+    pushFrame(clause, NULL, 0, 0);
+
+    while (walkStack.top > base)
+    {
+        Node *node = popFrame().node;
+
+        // If it's an OR node, extract from both sides (left first)
+        if (node->value == '+')
+        {
+            for (int i = node->numChildren - 1; i >= 0; i--)
+                pushFrame(node->children[i], NULL, 0, 0);
+            if (node->right != NULL)
+                pushFrame(node->right, NULL, 0, 0);
+            if (node->left != NULL)
+                pushFrame(node->left, NULL, 0, 0);
+        }
+        // If it's a negation
+        else if (node->value == '~')
+        {
+            if (node->left != NULL && !isOperator(node->left->value))
+            {
+                int varNum = getIntVar(node->left->var);
+                literals[(*litCount)++] = -varNum;
+            }
+        }
+        // If it's a literal (variable)
+        else if (!isOperator(node->value))
+        {
+            int varNum = getIntVar(node->var);
+            literals[(*litCount)++] = varNum;
+        }
+    }
+}
+
+// Convert parse tree (CNF) to DIMACS format in the given layout. Every clause's
+// literals go into one block, which never holds more than the tree has
+// nodes.
+DIMACSFormula *treeToDIMACSAs(Node *cnfRoot, int layout)
+{
+    DIMACSFormula *formula = createDIMACS(layout);
+
+    // Reset variable mapping
+    resetVarMapping();
+
+    // Extract all clauses
+    int maxClauses = countClauses(cnfRoot);
+    Node **clauseNodes = (Node **)malloc((maxClauses > 0 ? maxClauses : 1) * sizeof(Node *));
+    int clauseCount = 0;
+    extractClauses(cnfRoot, clauseNodes, &clauseCount, maxClauses);
+
+    size_t *clauseStart = (size_t *)malloc((clauseCount + 1) * sizeof(size_t));
+    int *literals = (int *)malloc(countNodes(cnfRoot) * sizeof(int));
+    clauseStart[0] = 0;
+
+    // Convert each clause
+    for (int i = 0; i < clauseCount; i++)
+    {
+        int litCount = 0;
+        extractLiterals(clauseNodes[i], literals + clauseStart[i], &litCount);
+        clauseStart[i + 1] = clauseStart[i] + litCount;
+    }
+    free(clauseNodes);
+
+    formula->literals = (int *)realloc(literals, (clauseStart[clauseCount] > 0 ? clauseStart[clauseCount] : 1) *
+                                                     sizeof(int));
+    formula->numClauses = clauseCount;
+    formula->numVars = varMap.size;
+    finishDIMACSLayout(formula, clauseStart, layout);
+
+    return formula;
+}
+
+// Convert parse tree (CNF) to DIMACS format
+DIMACSFormula *treeToDIMACS(Node *cnfRoot)
+{
+    return treeToDIMACSAs(cnfRoot, DIMACS_CLAUSE_LIST);
+}
+
+// ========== TSEITIN ENCODING ==========
+
+#define CNF_DISTRIBUTE 0 // convertToCNF, then treeToDIMACS (equivalent, may blow up)
+#define CNF_TSEITIN 1    // One auxiliary variable per gate (equisatisfiable, linear)
+#define CNF_PLAISTED_GREENBAUM 2 // Tseitin with only the clauses each gate's polarity needs
+
+// Add a clause to a formula being built; capacity is its clause capacity
+void appendClause(DIMACSFormula *formula, int *capacity, const int *literals, int size)
+{
+    if (formula->numClauses == *capacity)
+    {
+        *capacity = *capacity > 0 ? *capacity * 2 : 64;
+        formula->clauses = (Clause *)realloc(formula->clauses, *capacity * sizeof(Clause));
+    }
+
+    Clause *clause = &formula->clauses[formula->numClauses++];
+    clause->literals = (int *)malloc((size > 0 ? size : 1) * sizeof(int));
+    memcpy(clause->literals, literals, size * sizeof(int));
+    clause->size = size;
+}
+
+// Number a fresh auxiliary variable. Auxiliaries are named _t1, _t2, ...
+// (counter holds the last number used), skipping names the formula uses.
+int newAuxVar(int *counter)
+{
+    char name[32];
+    while (1)
+    {
+        int length = snprintf(name, sizeof(name), "_t%d", ++(*counter));
+        int symbol = internSymbol(name, length);
+        if (symbol < varMap.symbolCapacity && varMap.intOfSymbol[symbol] != 0)
+            continue;
+
+        int intVar = getIntVar(symbol);
+        if (varMap.firstAux == 0)
+            varMap.firstAux = intVar;
+        return intVar;
+    }
+}
+
+// Emit the clauses defining gate x = (l1 op ... op lk) for op '+' or '*'.
+// polarity says which directions are needed: 1 for x -> gate (x occurs
+// positively), -1 for gate -> x, 0 for both (x <-> gate).
+void emitGateClauses(DIMACSFormula *formula, int *capacity, int x, char op, const int *operands, int count,
+                     int polarity, int *scratch)
+{
+    // '*': x -> gate is (~x + li) for each i, gate -> x is (x + ~l1 + ... + ~lk)
+    // '+': gate -> x is (x + ~li) for each i, x -> gate is (~x + l1 + ... + lk)
+    int sign = op == '*' ? 1 : -1;
+    if (polarity == 0 || polarity == sign)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            int pair[2] = {-sign * x, sign * operands[i]};
+            appendClause(formula, capacity, pair, 2);
+        }
+    }
+
+    if (polarity == 0 || polarity == -sign)
+    {
+        scratch[0] = sign * x;
+        for (int i = 0; i < count; i++)
+        {
+            scratch[i + 1] = -sign * operands[i];
+        }
+        appendClause(formula, capacity, scratch, count + 1);
+    }
+}
+
+// Gate encoding of a tree, straight into DIMACS clauses. The result is
+// satisfiable exactly when the tree is, and is linear in the tree's size:
+// every '+', '*' and '>' gate gets an auxiliary variable, '~' only flips
+// the sign of a literal. The formula's own variables are numbered first,
+// in order of appearance; auxiliaries follow (varMap.firstAux onwards).
+// With polarityAware set each gate only gets the clauses for the polarity
+// it occurs in (Plaisted-Greenbaum), otherwise both directions (Tseitin).
+DIMACSFormula *encodeGatesToDIMACS(Node *root, bool polarityAware)
+{
+    DIMACSFormula *formula = createDIMACS(DIMACS_CLAUSE_LIST);
+    int capacity = 0;
+
+    resetVarMapping();
+    if (root == NULL)
+        return formula;
+
+    int varCount = 0;
+    int *vars = collectVariables(root, &varCount);
+    for (int i = 0; i < varCount; i++)
+    {
+        getIntVar(vars[i]);
+    }
+    free(vars);
+
+    // Post-order walk. A frame's value is the polarity of its subformula
+    // (1 or -1); operand literals wait on their own stack.
+    int literalCapacity = 64;
+    int *literals = (int *)malloc(literalCapacity * sizeof(int));
+    int scratchCapacity = 64;
+    int *scratch = (int *)malloc(scratchCapacity * sizeof(int));
+    int top = 0;
+    int auxCounter = 0;
+    int base = walkStack.top;
+    pushFrame(root, NULL, 0, 1);
+
+    while (walkStack.top > base)
+    {
+        WalkFrame frame = popFrame();
+        Node *node = frame.node;
+        int polarity = frame.value;
+
+        if (frame.state == 0 && isOperator(node->value))
+        {
+            // '~' and the left side of '>' see the opposite polarity
+            pushFrame(node, NULL, 1, polarity);
+            for (int i = node->numChildren - 1; i >= 0; i--)
+                pushFrame(node->children[i], NULL, 0, polarity);
+            if (node->right != NULL)
+                pushFrame(node->right, NULL, 0, polarity);
+            if (node->left != NULL)
+                pushFrame(node->left, NULL, 0, node->value == '~' || node->value == '>' ? -polarity : polarity);
+            continue;
+        }
+
+        if (top + 1 >= literalCapacity)
+        {
+            literalCapacity *= 2;
+            literals = (int *)realloc(literals, literalCapacity * sizeof(int));
+        }
+
+        if (!isOperator(node->value))
+        {
+            literals[top++] = getIntVar(node->var);
+            continue;
+        }
+        if (node->value == '~')
+        {
+            literals[top - 1] = -literals[top - 1];
+            continue;
+        }
+
+        int count = node->numChildren > 0 ? node->numChildren : 2;
+        if (count + 1 > scratchCapacity)
+        {
+            scratchCapacity = count + 1;
+            scratch = (int *)realloc(scratch, scratchCapacity * sizeof(int));
+        }
+        top -= count;
+
+        // a > b is (~a + b)
+        char op = node->value == '*' ? '*' : '+';
+        if (node->value == '>')
+            literals[top] = -literals[top];
+
+        int x = newAuxVar(&auxCounter);
+        emitGateClauses(formula, &capacity, x, op, &literals[top], count, polarityAware ? polarity : 0, scratch);
+        literals[top++] = x;
+    }
+
+    // The whole formula must hold
+    appendClause(formula, &capacity, &literals[0], 1);
+    formula->numVars = varMap.size;
+
+    free(literals);
+    free(scratch);
+    return formula;
+}
+
+// Tseitin encoding: both directions of every gate definition
+DIMACSFormula *tseitinToDIMACS(Node *root)
+{
+    return encodeGatesToDIMACS(root, false);
+}
+
+// Plaisted-Greenbaum encoding: only the direction each gate's polarity
+// needs, about half the clauses of tseitinToDIMACS. Still equisatisfiable.
+DIMACSFormula *plaistedGreenbaumToDIMACS(Node *root)
+{
+    return encodeGatesToDIMACS(root, true);
+}
+
+// ========== CLAUSE-SET CNF ==========
+
+#define CNF_CLAUSE_SET 3 // Distribution on sets of sorted clauses (equivalent, no redundant clauses)
+
+// Sort key of a literal: by variable, x before ~x
+int literalKey(int literal)
+{
+    return literal > 0 ? 2 * literal : -2 * literal + 1;
+}
+
+// FNV-1a hash of a sorted clause
+uint64_t hashClause(const int *literals, int size)
+{
+    uint64_t h = 0xCBF29CE484222325ULL;
+    for (int i = 0; i < size; i++)
+    {
+        h ^= (uint32_t)literals[i];
+        h *= 0x100000001B3ULL;
+    }
+    return h;
+}
+
+ClauseSet *createClauseSet(void)
+{
+    ClauseSet *set = (ClauseSet *)malloc(sizeof(ClauseSet));
+    set->numClauses = 0;
+    set->clauseCapacity = 16;
+    set->literalCapacity = 64;
+    set->literals = (int *)malloc(set->literalCapacity * sizeof(int));
+    set->start = (int *)malloc((set->clauseCapacity + 1) * sizeof(int));
+    set->start[0] = 0;
+    set->hash = (uint64_t *)malloc(set->clauseCapacity * sizeof(uint64_t));
+    set->signature = (uint64_t *)malloc(set->clauseCapacity * sizeof(uint64_t));
+    set->slotCapacity = 32;
+    set->slots = (int *)calloc(set->slotCapacity, sizeof(int));
+    return set;
+}
+
+void freeClauseSet(ClauseSet *set)
+{
+    free(set->literals);
+    free(set->start);
+    free(set->hash);
+    free(set->signature);
+    free(set->slots);
+    free(set);
+}
+
+// Refill the hash table with every clause, at the given capacity
+void rebuildClauseSlots(ClauseSet *set, int capacity)
+{
+    if (capacity != set->slotCapacity)
+    {
+        free(set->slots);
+        set->slotCapacity = capacity;
+        set->slots = (int *)malloc(capacity * sizeof(int));
+    }
+    memset(set->slots, 0, capacity * sizeof(int));
+
+    int mask = capacity - 1;
+    for (int c = 0; c < set->numClauses; c++)
+    {
+        int i = (int)(set->hash[c] & mask);
+        while (set->slots[i] != 0)
+            i = (i + 1) & mask;
+        set->slots[i] = c + 1;
+    }
+}
+
+// Append a clause with the given hash, without looking for duplicates or
+// updating the hash table
+void pushClauseToSet(ClauseSet *set, const int *literals, int size, uint64_t h)
+{
+    int n = set->numClauses;
+    if (n == set->clauseCapacity)
+    {
+        set->clauseCapacity *= 2;
+        set->start = (int *)realloc(set->start, (set->clauseCapacity + 1) * sizeof(int));
+        set->hash = (uint64_t *)realloc(set->hash, set->clauseCapacity * sizeof(uint64_t));
+        set->signature = (uint64_t *)realloc(set->signature, set->clauseCapacity * sizeof(uint64_t));
+    }
+    if (set->start[n] + size > set->literalCapacity)
+    {
+        while (set->start[n] + size > set->literalCapacity)
+            set->literalCapacity *= 2;
+        set->literals = (int *)realloc(set->literals, set->literalCapacity * sizeof(int));
+    }
+
+    uint64_t signature = 0;
+    for (int j = 0; j < size; j++)
+        signature |= 1ULL << (literalKey(literals[j]) & 63);
+
+    memcpy(&set->literals[set->start[n]], literals, size * sizeof(int));
+    set->start[n + 1] = set->start[n] + size;
+    set->hash[n] = h;
+    set->signature[n] = signature;
+    set->numClauses++;
+}
+
+// Append literals to the last clause of a set (its hash is not updated)
+void extendLastClause(ClauseSet *set, const int *literals, int size)
+{
+    int n = set->numClauses;
+    while (set->start[n] + size > set->literalCapacity)
+    {
+        set->literalCapacity *= 2;
+        set->literals = (int *)realloc(set->literals, set->literalCapacity * sizeof(int));
+    }
+    memcpy(&set->literals[set->start[n]], literals, size * sizeof(int));
+    for (int j = 0; j < size; j++)
+        set->signature[n - 1] |= 1ULL << (literalKey(literals[j]) & 63);
+    set->start[n] += size;
+}
+
+// Add a sorted, tautology-free clause unless the set already has it
+void addClauseToSet(ClauseSet *set, const int *literals, int size, ClauseSetStats *stats)
+{
+    uint64_t h = hashClause(literals, size);
+    int mask = set->slotCapacity - 1;
+    int i = (int)(h & mask);
+    for (; set->slots[i] != 0; i = (i + 1) & mask)
+    {
+        int c = set->slots[i] - 1;
+        if (set->hash[c] == h && set->start[c + 1] - set->start[c] == size &&
+            memcmp(&set->literals[set->start[c]], literals, size * sizeof(int)) == 0)
+        {
+            stats->duplicates++;
+            return;
+        }
+    }
+
+    pushClauseToSet(set, literals, size, h);
+
+    // Keep the table at most half full
+    if (2 * set->numClauses > set->slotCapacity)
+        rebuildClauseSlots(set, set->slotCapacity * 2);
+    else
+        set->slots[i] = set->numClauses;
+}
+
+// Is sorted clause a contained in sorted clause b?
+bool clauseSubsetOf(const int *a, int sizeA, const int *b, int sizeB)
+{
+    int j = 0;
+    for (int i = 0; i < sizeA; i++)
+    {
+        int key = literalKey(a[i]);
+        while (j < sizeB && literalKey(b[j]) < key)
+            j++;
+        if (j == sizeB || b[j] != a[i])
+            return false;
+        j++;
+    }
+    return true;
+}
+
+// Drop every clause that contains another clause of the set. Clauses are
+// visited shortest first and checked only against the kept clauses whose
+// first literal they contain, found through one list per literal.
+void reduceClauseSet(ClauseSet *set, ClauseSetStats *stats)
+{
+    int n = set->numClauses;
+    if (n < 2)
+        return;
+
+    // Counting sort of the clauses by size, and the largest literal key
+    int maxSize = 0, maxKey = 0;
+    for (int c = 0; c < n; c++)
+    {
+        int size = set->start[c + 1] - set->start[c];
+        if (size > maxSize)
+            maxSize = size;
+    }
+    for (int i = 0; i < set->start[n]; i++)
+    {
+        int key = literalKey(set->literals[i]);
+        if (key > maxKey)
+            maxKey = key;
+    }
+    int *sizeStart = (int *)calloc(maxSize + 2, sizeof(int));
+    for (int c = 0; c < n; c++)
+        sizeStart[set->start[c + 1] - set->start[c] + 1]++;
+    for (int s = 1; s <= maxSize + 1; s++)
+        sizeStart[s] += sizeStart[s - 1];
+    int *order = (int *)malloc(n * sizeof(int));
+    for (int c = 0; c < n; c++)
+        order[sizeStart[set->start[c + 1] - set->start[c]]++] = c;
+    free(sizeStart);
+
+    int *heads = (int *)malloc((maxKey + 1) * sizeof(int));
+    for (int k = 0; k <= maxKey; k++)
+        heads[k] = -1;
+    int *next = (int *)malloc(n * sizeof(int));
+    unsigned char *keep = (unsigned char *)calloc(n, 1);
+    bool keptEmpty = false;
+
+    for (int o = 0; o < n; o++)
+    {
+        int c = order[o];
+        const int *clause = &set->literals[set->start[c]];
+        int size = set->start[c + 1] - set->start[c];
+        bool subsumed = keptEmpty;
+
+        for (int i = 0; i < size && !subsumed; i++)
+        {
+            for (int d = heads[literalKey(clause[i])]; d >= 0; d = next[d])
+            {
+                if ((set->signature[d] & ~set->signature[c]) == 0 &&
+                    clauseSubsetOf(&set->literals[set->start[d]], set->start[d + 1] - set->start[d], clause, size))
+                {
+                    subsumed = true;
+                    break;
+                }
+            }
+        }
+
+        if (subsumed)
+        {
+            stats->subsumed++;
+            continue;
+        }
+        keep[c] = 1;
+        if (size == 0)
+        {
+            keptEmpty = true;
+            continue;
+        }
+        int first = literalKey(clause[0]);
+        next[c] = heads[first];
+        heads[first] = c;
+    }
+
+    // Compact in place, keeping the original order
+    int kept = 0;
+    int begin = set->start[0];
+    for (int c = 0; c < n; c++)
+    {
+        int end = set->start[c + 1];
+        if (keep[c])
+        {
+            int size = end - begin;
+            memmove(&set->literals[set->start[kept]], &set->literals[begin], size * sizeof(int));
+            set->start[kept + 1] = set->start[kept] + size;
+            set->hash[kept] = set->hash[c];
+            set->signature[kept] = set->signature[c];
+            kept++;
+        }
+        begin = end;
+    }
+    set->numClauses = kept;
+    rebuildClauseSlots(set, set->slotCapacity);
+
+    free(order);
+    free(heads);
+    free(next);
+    free(keep);
+}
+
+// Do two sets mention a common variable? mark has an entry per variable
+// and *stamp is a number no entry holds yet; it is advanced on each call.
+bool clauseSetsShareVariable(ClauseSet *a, ClauseSet *b, int *mark, int *stamp)
+{
+    (*stamp)++;
+    for (int i = 0; i < a->start[a->numClauses]; i++)
+        mark[abs(a->literals[i])] = *stamp;
+    for (int i = 0; i < b->start[b->numClauses]; i++)
+        if (mark[abs(b->literals[i])] == *stamp)
+            return true;
+    return false;
+}
+
+// Clauses of (a + b): every clause of a merged with every clause of b,
+// dropping the merges that contain both x and ~x. When a and b share no
+// variable nothing can be subsumed, so reduce may be false.
+ClauseSet *clauseSetProduct(ClauseSet *a, ClauseSet *b, bool reduce, ClauseSetStats *stats)
+{
+    ClauseSet *result = createClauseSet();
+    int maxA = 0, maxB = 0;
+    for (int i = 0; i < a->numClauses; i++)
+        if (a->start[i + 1] - a->start[i] > maxA)
+            maxA = a->start[i + 1] - a->start[i];
+    for (int j = 0; j < b->numClauses; j++)
+        if (b->start[j + 1] - b->start[j] > maxB)
+            maxB = b->start[j + 1] - b->start[j];
+    int *merged = (int *)malloc((maxA + maxB + 1) * sizeof(int));
+
+    for (int i = 0; i < a->numClauses; i++)
+    {
+        for (int j = 0; j < b->numClauses; j++)
+        {
+            const int *p = &a->literals[a->start[i]], *endP = &a->literals[a->start[i + 1]];
+            const int *q = &b->literals[b->start[j]], *endQ = &b->literals[b->start[j + 1]];
+            int size = 0;
+            bool tautology = false;
+            stats->products++;
+
+            while (p < endP && q < endQ)
+            {
+                int keyP = literalKey(*p), keyQ = literalKey(*q);
+                if (keyP == keyQ)
+                {
+                    merged[size++] = *p++;
+                    q++;
+                }
+                else if ((keyP >> 1) == (keyQ >> 1))
+                {
+                    tautology = true;
+                    break;
+                }
+                else if (keyP < keyQ)
+                    merged[size++] = *p++;
+                else
+                    merged[size++] = *q++;
+            }
+            if (tautology)
+            {
+                stats->tautologies++;
+                continue;
+            }
+            while (p < endP)
+                merged[size++] = *p++;
+            while (q < endQ)
+                merged[size++] = *q++;
+
+            addClauseToSet(result, merged, size, stats);
+        }
+    }
+
+    free(merged);
+    if (reduce)
+        reduceClauseSet(result, stats);
+    return result;
+}
+
+// Clauses of (into * from), stored in into; from is freed. reduce as for
+// clauseSetProduct.
+void clauseSetUnion(ClauseSet *into, ClauseSet *from, bool reduce, ClauseSetStats *stats)
+{
+    for (int c = 0; c < from->numClauses; c++)
+        addClauseToSet(into, &from->literals[from->start[c]], from->start[c + 1] - from->start[c], stats);
+    freeClauseSet(from);
+    if (reduce)
+        reduceClauseSet(into, stats);
+}
+
+// CNF of a tree by distribution, built on clause sets instead of trees.
+// Negations are pushed to the leaves on the fly: a subtree is visited with
+// a polarity, and a negative '*' combines like '+' and the other way round.
+// Each operator's operand sets are combined pairwise as soon as they are
+// ready, and every result is kept free of tautologies, duplicate and
+// subsumed clauses, so the output is equivalent to convertToCNF's but never
+// larger. Variables are numbered in order of appearance. stats may be NULL.
+DIMACSFormula *clauseSetToDIMACS(Node *root, ClauseSetStats *stats)
+{
+    ClauseSetStats localStats = {0, 0, 0, 0};
+    DIMACSFormula *formula = createDIMACS(DIMACS_CLAUSE_LIST);
+
+    resetVarMapping();
+    if (stats != NULL)
+        *stats = localStats;
+    if (root == NULL)
+        return formula;
+
+    int varCount = 0;
+    int *vars = collectVariables(root, &varCount);
+    for (int i = 0; i < varCount; i++)
+    {
+        getIntVar(vars[i]);
+    }
+    free(vars);
+    int *mark = (int *)calloc(varMap.size + 1, sizeof(int));
+    int stamp = 0;
+
+    // Post-order walk; a frame's value is the polarity of its subtree
+    int setCapacity = 64;
+    ClauseSet **sets = (ClauseSet **)malloc(setCapacity * sizeof(ClauseSet *));
+    int top = 0;
+    int base = walkStack.top;
+    pushFrame(root, NULL, 0, 1);
+
+    while (walkStack.top > base)
+    {
+        WalkFrame frame = popFrame();
+        Node *node = frame.node;
+        int polarity = frame.value;
+
+        if (frame.state == 0 && isOperator(node->value))
+        {
+            // '~' and the left side of '>' see the opposite polarity
+            pushFrame(node, NULL, 1, polarity);
+            for (int i = node->numChildren - 1; i >= 0; i--)
+                pushFrame(node->children[i], NULL, 0, polarity);
+            if (node->right != NULL)
+                pushFrame(node->right, NULL, 0, polarity);
+            if (node->left != NULL)
+                pushFrame(node->left, NULL, 0, node->value == '~' || node->value == '>' ? -polarity : polarity);
+            continue;
+        }
+
+        if (!isOperator(node->value))
+        {
+            if (top == setCapacity)
+            {
+                setCapacity *= 2;
+                sets = (ClauseSet **)realloc(sets, setCapacity * sizeof(ClauseSet *));
+            }
+            int literal = polarity * getIntVar(node->var);
+            sets[top] = createClauseSet();
+            addClauseToSet(sets[top++], &literal, 1, &localStats);
+            continue;
+        }
+        if (node->value == '~')
+            continue;
+
+        // a > b is (~a + b), and its left side already has the flipped polarity
+        int count = node->numChildren > 0 ? node->numChildren : 2;
+        bool conjunction = (node->value == '*') == (polarity > 0);
+        top -= count;
+        ClauseSet *result = sets[top];
+        for (int i = 1; i < count; i++)
+        {
+            bool reduce = clauseSetsShareVariable(result, sets[top + i], mark, &stamp);
+            if (conjunction)
+            {
+                clauseSetUnion(result, sets[top + i], reduce, &localStats);
+            }
+            else
+            {
+                ClauseSet *product = clauseSetProduct(result, sets[top + i], reduce, &localStats);
+                freeClauseSet(result);
+                freeClauseSet(sets[top + i]);
+                result = product;
+            }
+        }
+        sets[top++] = result;
+    }
+
+    ClauseSet *result = sets[0];
+    formula->clauses = (Clause *)malloc((result->numClauses > 0 ? result->numClauses : 1) * sizeof(Clause));
+    formula->numClauses = result->numClauses;
+    for (int c = 0; c < result->numClauses; c++)
+    {
+        int size = result->start[c + 1] - result->start[c];
+        formula->clauses[c].literals = (int *)malloc((size > 0 ? size : 1) * sizeof(int));
+        memcpy(formula->clauses[c].literals, &result->literals[result->start[c]], size * sizeof(int));
+        formula->clauses[c].size = size;
+    }
+    formula->numVars = varMap.size;
+
+    freeClauseSet(result);
+    free(sets);
+    free(mark);
+    if (stats != NULL)
+        *stats = localStats;
+    return formula;
+}
+
+// ========== CNF PLANNER ==========
+
+#define CNF_PLANNED 4 // Distribution, naming subtrees that would exceed a clause budget
+#define CNF_DEFAULT_BUDGET 1024
+
+// a + b and a * b, saturating at LLONG_MAX
+long long saturatingAdd(long long a, long long b)
+{
+    return a > LLONG_MAX - b ? LLONG_MAX : a + b;
+}
+
+long long saturatingMultiply(long long a, long long b)
+{
+    if (a == 0 || b == 0)
+        return 0;
+    return a > LLONG_MAX / b ? LLONG_MAX : a * b;
+}
+
+// Size of the CNF of (A + B), from the sizes of A and B: every clause of A
+// is joined with every clause of B
+void productSize(long long *clauses, long long *literals, long long otherClauses, long long otherLiterals)
+{
+    long long l = saturatingAdd(saturatingMultiply(*literals, otherClauses),
+                                saturatingMultiply(otherLiterals, *clauses));
+    *clauses = saturatingMultiply(*clauses, otherClauses);
+    *literals = l;
+}
+
+// Walk a tree in the post-order the planner numbers nodes in. Each call
+// returns the next node, its polarity and its operand count (0 for a
+// leaf); base is walkStack.top when the walk started.
+Node *nextPlanNode(int base, int *polarity)
+{
+    while (walkStack.top > base)
+    {
+        WalkFrame frame = popFrame();
+        Node *node = frame.node;
+        if (frame.state == 0 && isOperator(node->value))
+        {
+            // '~' and the left side of '>' see the opposite polarity
+            pushFrame(node, NULL, 1, frame.value);
+            for (int i = node->numChildren - 1; i >= 0; i--)
+                pushFrame(node->children[i], NULL, 0, frame.value);
+            if (node->right != NULL)
+                pushFrame(node->right, NULL, 0, frame.value);
+            if (node->left != NULL)
+                pushFrame(node->left, NULL, 0,
+                          node->value == '~' || node->value == '>' ? -frame.value : frame.value);
+            continue;
+        }
+        *polarity = frame.value;
+        return node;
+    }
+    return NULL;
+}
+
+// Number of operands of an operator node
+int operandCount(Node *node)
+{
+    if (node->value == '~')
+        return 1;
+    return node->numChildren > 0 ? node->numChildren : 2;
+}
+
+// Does an operator combine its operands' clauses by concatenation (true)
+// or by cross product? '~' has one operand and counts as a conjunction.
+bool isConjunction(Node *node, int polarity)
+{
+    return node->value == '~' || (node->value == '*') == (polarity > 0);
+}
+
+int compareLongLong(const void *a, const void *b)
+{
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+// Name the largest operands of an OR until the product of the clause
+// counts fits in budget. That leaves the longest run of smallest operands
+// whose product fits, so sorting the counts once finds the cut-off.
+void nameLargestOperands(CnfPlan *plan, const int *children, int count, long long budget)
+{
+    long long *sizes = (long long *)malloc(count * sizeof(long long));
+    for (int i = 0; i < count; i++)
+        sizes[i] = plan->entries[children[i]].clauses;
+    qsort(sizes, count, sizeof(long long), compareLongLong);
+
+    // Keep every operand below limit, and keepAtLimit of those equal to it
+    long long product = 1;
+    int kept = 0;
+    while (kept < count && saturatingMultiply(product, sizes[kept]) <= budget)
+        product = saturatingMultiply(product, sizes[kept++]);
+    if (kept == count)
+    {
+        free(sizes);
+        return;
+    }
+    long long limit = sizes[kept];
+    int keepAtLimit = 0;
+    for (int i = kept - 1; i >= 0 && sizes[i] == limit; i--)
+        keepAtLimit++;
+    free(sizes);
+
+    for (int i = 0; i < count; i++)
+    {
+        CnfPlanEntry *child = &plan->entries[children[i]];
+        if (child->clauses < limit || child->clauses <= 1)
+            continue;
+        if (child->clauses == limit && keepAtLimit > 0)
+        {
+            keepAtLimit--;
+            continue;
+        }
+
+        // Definitions: each of its clauses gains ~x
+        plan->totalClauses = saturatingAdd(plan->totalClauses, child->clauses);
+        plan->totalLiterals = saturatingAdd(plan->totalLiterals, saturatingAdd(child->literals, child->clauses));
+        plan->namedSubtrees++;
+        child->named = true;
+        child->clauses = child->literals = 1;
+    }
+}
+
+// Plan the CNF of a tree. Sizes are computed bottom-up in one pass without
+// building anything: a leaf is one clause of one literal, an AND adds its
+// operands' sizes and an OR multiplies them (negations are pushed to the
+// leaves, so a negative '*' is an OR). These are exactly the sizes
+// convertToCNF produces. When an OR would exceed budget clauses, its
+// largest operands are named, largest first, until it fits: a named
+// operand becomes one literal x, and its clauses are output once as
+// (~x + clause) definitions.
+CnfPlan *planCNF(Node *root, long long budget)
+{
+    CnfPlan *plan = (CnfPlan *)calloc(1, sizeof(CnfPlan));
+    plan->budget = budget;
+    if (root == NULL)
+        return plan;
+
+    int capacity = countNodes(root);
+    plan->nodes = (Node **)malloc(capacity * sizeof(Node *));
+    plan->entries = (CnfPlanEntry *)malloc(capacity * sizeof(CnfPlanEntry));
+    int *operands = (int *)malloc(capacity * sizeof(int));
+    int top = 0;
+
+    int base = walkStack.top;
+    pushFrame(root, NULL, 0, 1);
+    Node *node;
+    int polarity;
+    while ((node = nextPlanNode(base, &polarity)) != NULL)
+    {
+        int index = plan->numNodes++;
+        CnfPlanEntry *entry = &plan->entries[index];
+        plan->nodes[index] = node;
+        entry->polarity = polarity;
+        entry->named = false;
+
+        if (!isOperator(node->value))
+        {
+            entry->clauses = entry->literals = 1;
+            entry->distributeClauses = entry->distributeLiterals = 1;
+            operands[top++] = index;
+            continue;
+        }
+
+        int count = operandCount(node);
+        top -= count;
+        int *children = &operands[top];
+        bool conjunction = isConjunction(node, polarity);
+
+        // Plain distribution, ignoring names
+        CnfPlanEntry *first = &plan->entries[children[0]];
+        entry->distributeClauses = first->distributeClauses;
+        entry->distributeLiterals = first->distributeLiterals;
+        for (int i = 1; i < count; i++)
+        {
+            CnfPlanEntry *child = &plan->entries[children[i]];
+            if (conjunction)
+            {
+                entry->distributeClauses = saturatingAdd(entry->distributeClauses, child->distributeClauses);
+                entry->distributeLiterals = saturatingAdd(entry->distributeLiterals, child->distributeLiterals);
+            }
+            else
+                productSize(&entry->distributeClauses, &entry->distributeLiterals, child->distributeClauses,
+                            child->distributeLiterals);
+        }
+
+        if (!conjunction && count > 1)
+            nameLargestOperands(plan, children, count, budget);
+
+        entry->clauses = first->clauses;
+        entry->literals = first->literals;
+        for (int i = 1; i < count; i++)
+        {
+            CnfPlanEntry *child = &plan->entries[children[i]];
+            if (conjunction)
+            {
+                entry->clauses = saturatingAdd(entry->clauses, child->clauses);
+                entry->literals = saturatingAdd(entry->literals, child->literals);
+            }
+            else
+                productSize(&entry->clauses, &entry->literals, child->clauses, child->literals);
+        }
+
+        operands[top++] = index;
+    }
+
+    CnfPlanEntry *rootEntry = &plan->entries[plan->numNodes - 1];
+    plan->totalClauses = saturatingAdd(plan->totalClauses, rootEntry->clauses);
+    plan->totalLiterals = saturatingAdd(plan->totalLiterals, rootEntry->literals);
+    plan->distributeClauses = rootEntry->distributeClauses;
+    plan->distributeLiterals = rootEntry->distributeLiterals;
+
+    free(operands);
+    return plan;
+}
+
+void freeCnfPlan(CnfPlan *plan)
+{
+    free(plan->nodes);
+    free(plan->entries);
+    free(plan);
+}
+
+// Print the predicted sizes and every named subtree
+void printCnfPlan(CnfPlan *plan)
+{
+    printf("CNF plan (budget %lld clauses per OR):\n", plan->budget);
+    printf("  Plain distribution: %lld clauses, %lld literals\n", plan->distributeClauses, plan->distributeLiterals);
+    printf("  Planned output:     %lld clauses, %lld literals, %d named subtrees\n", plan->totalClauses,
+           plan->totalLiterals, plan->namedSubtrees);
+
+    for (int i = 0; i < plan->numNodes; i++)
+    {
+        CnfPlanEntry *entry = &plan->entries[i];
+        if (!entry->named)
+            continue;
+        printf("  Named (%s, %lld clauses if distributed): ", entry->polarity > 0 ? "positive" : "negative",
+               entry->distributeClauses);
+        inorderTraversal(plan->nodes[i]);
+        printf("\n");
+    }
+}
+
+// Append the clauses of (s1 + ... + sk) to result: one clause from each
+// operand, joined in operand order, with the last operand varying fastest.
+// Every combination is built once, so the work is linear in the output.
+// scratch holds the widest clause.
+void appendClauseProduct(ClauseSet *result, ClauseSet **operands, int count, int *scratch)
+{
+    for (int i = 0; i < count; i++)
+        if (operands[i]->numClauses == 0)
+            return;
+
+    int *choice = (int *)calloc(count, sizeof(int));
+    while (1)
+    {
+        int size = 0;
+        for (int i = 0; i < count; i++)
+        {
+            ClauseSet *operand = operands[i];
+            int length = operand->start[choice[i] + 1] - operand->start[choice[i]];
+            memcpy(&scratch[size], &operand->literals[operand->start[choice[i]]], length * sizeof(int));
+            size += length;
+        }
+        pushClauseToSet(result, scratch, size, 0);
+
+        int i = count - 1;
+        while (i >= 0 && ++choice[i] == operands[i]->numClauses)
+            choice[i--] = 0;
+        if (i < 0)
+            break;
+    }
+    free(choice);
+}
+
+// Do all the sets hold exactly one clause?
+bool singleClauseOperands(ClauseSet **operands, int count)
+{
+    for (int i = 0; i < count; i++)
+        if (operands[i]->numClauses != 1)
+            return false;
+    return true;
+}
+
+// Clauses of an operator from its operands' clause sets, which are freed:
+// the operands' clauses in order for a conjunction, their cross product
+// for a disjunction. A single-clause disjunction grows its longest operand,
+// so its literals need not follow operand order. *scratch grows to the
+// widest clause as needed.
+ClauseSet *combineClauseSets(ClauseSet **operands, int count, bool conjunction, int **scratch, int *scratchCapacity)
+{
+    ClauseSet *result;
+    if (conjunction || count == 1)
+    {
+        result = operands[0];
+        for (int i = 1; i < count; i++)
+        {
+            ClauseSet *operand = operands[i];
+            for (int c = 0; c < operand->numClauses; c++)
+                pushClauseToSet(result, &operand->literals[operand->start[c]], operand->start[c + 1] - operand->start[c],
+                                0);
+            freeClauseSet(operand);
+        }
+    }
+    else if (singleClauseOperands(operands, count))
+    {
+        // One clause: grow the longest operand's in place, so deep chains
+        // of ORs are not copied at every level
+        int longest = 0;
+        for (int i = 1; i < count; i++)
+            if (operands[i]->start[1] > operands[longest]->start[1])
+                longest = i;
+        result = operands[longest];
+        for (int i = 0; i < count; i++)
+        {
+            if (i == longest)
+                continue;
+            extendLastClause(result, operands[i]->literals, operands[i]->start[1]);
+            freeClauseSet(operands[i]);
+        }
+    }
+    else
+    {
+        int widest = 0;
+        for (int i = 0; i < count; i++)
+            widest += operands[i]->start[operands[i]->numClauses];
+        if (widest > *scratchCapacity)
+        {
+            *scratchCapacity = widest;
+            *scratch = (int *)realloc(*scratch, *scratchCapacity * sizeof(int));
+        }
+        result = createClauseSet();
+        appendClauseProduct(result, operands, count, *scratch);
+        for (int i = 0; i < count; i++)
+            freeClauseSet(operands[i]);
+    }
+    return result;
+}
+
+// Convert a tree to DIMACS following a plan from planCNF for the same
+// tree. The output has exactly the plan's predicted size; named subtrees
+// become auxiliary variables numbered after the formula's own.
+DIMACSFormula *plannedToDIMACS(Node *root, CnfPlan *plan)
+{
+    DIMACSFormula *formula = createDIMACS(DIMACS_CLAUSE_LIST);
+    int capacity = 0;
+
+    resetVarMapping();
+    if (root == NULL)
+        return formula;
+
+    int varCount = 0;
+    int *vars = collectVariables(root, &varCount);
+    for (int i = 0; i < varCount; i++)
+    {
+        getIntVar(vars[i]);
+    }
+    free(vars);
+
+    ClauseSet **sets = (ClauseSet **)malloc(plan->numNodes * sizeof(ClauseSet *));
+    int top = 0;
+    int auxCounter = 0;
+    int scratchCapacity = 64;
+    int *scratch = (int *)malloc(scratchCapacity * sizeof(int));
+
+    int base = walkStack.top;
+    pushFrame(root, NULL, 0, 1);
+    Node *node;
+    int polarity;
+    for (int index = 0; (node = nextPlanNode(base, &polarity)) != NULL; index++)
+    {
+        CnfPlanEntry *entry = &plan->entries[index];
+        ClauseSet *result;
+
+        if (!isOperator(node->value))
+        {
+            int literal = polarity * getIntVar(node->var);
+            result = createClauseSet();
+            pushClauseToSet(result, &literal, 1, 0);
+        }
+        else
+        {
+            int count = operandCount(node);
+            top -= count;
+            result = combineClauseSets(&sets[top], count, isConjunction(node, polarity), &scratch, &scratchCapacity);
+        }
+
+        if (entry->named)
+        {
+            // x -> subtree: (~x + clause) for every clause
+            int x = newAuxVar(&auxCounter);
+            for (int c = 0; c < result->numClauses; c++)
+            {
+                int size = result->start[c + 1] - result->start[c];
+                if (size + 1 > scratchCapacity)
+                {
+                    scratchCapacity = size + 1;
+                    scratch = (int *)realloc(scratch, scratchCapacity * sizeof(int));
+                }
+                scratch[0] = -x;
+                memcpy(&scratch[1], &result->literals[result->start[c]], size * sizeof(int));
+                appendClause(formula, &capacity, scratch, size + 1);
+            }
+            freeClauseSet(result);
+            result = createClauseSet();
+            pushClauseToSet(result, &x, 1, 0);
+        }
+        sets[top++] = result;
+    }
+
+    ClauseSet *result = sets[0];
+    for (int c = 0; c < result->numClauses; c++)
+        appendClause(formula, &capacity, &result->literals[result->start[c]], result->start[c + 1] - result->start[c]);
+    formula->numVars = varMap.size;
+
+    freeClauseSet(result);
+    free(sets);
+    free(scratch);
+    return formula;
+}
+
+// ========== PARALLEL CNF ==========
+
+#define CNF_PARALLEL 5           // Distribution on a work-stealing pool (equivalent)
+#define PARALLEL_CNF_GRAIN 4096  // Subtrees smaller than this many nodes are not split
+
+// Operand i of an operator node
+Node *operandAt(Node *node, int i)
+{
+    if (node->numChildren > 0)
+        return node->children[i];
+    return i == 0 ? node->left : node->right;
+}
+
+// Polarity of operand i of a node with the given polarity
+int operandPolarity(Node *node, int i, int polarity)
+{
+    return node->value == '~' || (node->value == '>' && i == 0) ? -polarity : polarity;
+}
+
+CnfTask *createCnfTask(Node *node, int first, int last)
+{
+    CnfTask *task = (CnfTask *)calloc(1, sizeof(CnfTask));
+    task->node = node;
+    task->first = first;
+    task->last = last;
+    return task;
+}
+
+void freeCnfTasks(CnfTask *task)
+{
+    for (int i = 0; i < task->numChildren; i++)
+        freeCnfTasks(task->children[i]);
+    free(task->children);
+    free(task);
+}
+
+// Split a tree into tasks, bottom-up: an operator with at least
+// PARALLEL_CNF_GRAIN nodes gets a task, whose children are the tasks of
+// its large operands and leaf tasks over runs of its small ones (each run
+// about PARALLEL_CNF_GRAIN nodes). Returns NULL when the tree is too small
+// to split.
+CnfTask *buildCnfTasks(Node *root, int *numTasks)
+{
+    int capacity = 64;
+    int *sizes = (int *)malloc(capacity * sizeof(int));
+    CnfTask **tasks = (CnfTask **)malloc(capacity * sizeof(CnfTask *));
+    int top = 0;
+    *numTasks = 0;
+
+    int base = walkStack.top;
+    pushFrame(root, NULL, 0, 0);
+    while (walkStack.top > base)
+    {
+        WalkFrame frame = popFrame();
+        Node *node = frame.node;
+        if (frame.state == 0 && isOperator(node->value))
+        {
+            pushFrame(node, NULL, 1, 0);
+            int count = operandCount(node);
+            for (int i = count - 1; i >= 0; i--)
+                pushFrame(operandAt(node, i), NULL, 0, 0);
+            continue;
+        }
+
+        if (top == capacity)
+        {
+            capacity *= 2;
+            sizes = (int *)realloc(sizes, capacity * sizeof(int));
+            tasks = (CnfTask **)realloc(tasks, capacity * sizeof(CnfTask *));
+        }
+        if (!isOperator(node->value))
+        {
+            sizes[top] = 1;
+            tasks[top++] = NULL;
+            continue;
+        }
+
+        int count = operandCount(node);
+        top -= count;
+        int size = 1;
+        for (int i = 0; i < count; i++)
+            size += sizes[top + i];
+
+        CnfTask *task = NULL;
+        if (size >= PARALLEL_CNF_GRAIN)
+        {
+            task = createCnfTask(node, 0, count);
+            task->children = (CnfTask **)malloc(count * sizeof(CnfTask *));
+            for (int i = 0; i < count;)
+            {
+                CnfTask *child = tasks[top + i];
+                if (child == NULL)
+                {
+                    // A run of small operands
+                    int first = i, runSize = 0;
+                    while (i < count && tasks[top + i] == NULL && runSize < PARALLEL_CNF_GRAIN)
+                        runSize += sizes[top + i++];
+                    child = createCnfTask(node, first, i);
+                    (*numTasks)++;
+                }
+                else
+                    child->flipped = operandPolarity(node, i++, 1) < 0;
+                child->parent = task;
+                task->children[task->numChildren++] = child;
+            }
+            (*numTasks)++;
+        }
+        sizes[top] = size;
+        tasks[top++] = task;
+    }
+
+    CnfTask *rootTask = tasks[0];
+    free(sizes);
+    free(tasks);
+    return rootTask;
+}
+
+// Append the clauses of a CNF tree to a set: one clause per operand of
+// its top-level AND chain, literals in tree order
+void appendCnfTreeClauses(ClauseSet *set, Node *cnf, int **scratch, int *scratchCapacity)
+{
+    int size = 0;
+    int base = walkStack.top;
+    pushFrame(cnf, NULL, 0, 0);
+
+    // Frame value 1 marks nodes inside a clause; state 1 ends a clause
+    while (walkStack.top > base)
+    {
+        WalkFrame frame = popFrame();
+        Node *node = frame.node;
+        if (frame.state == 1)
+        {
+            pushClauseToSet(set, *scratch, size, 0);
+            size = 0;
+            continue;
+        }
+        if (frame.value == 0 && node->value != '*')
+        {
+            pushFrame(node, NULL, 1, 0);
+            pushFrame(node, NULL, 0, 1);
+            continue;
+        }
+        if (frame.value == 1 && (!isOperator(node->value) || (node->value == '~' && !isOperator(node->left->value))))
+        {
+            if (size == *scratchCapacity)
+            {
+                *scratchCapacity *= 2;
+                *scratch = (int *)realloc(*scratch, *scratchCapacity * sizeof(int));
+            }
+            (*scratch)[size++] = node->value == '~' ? -getIntVar(node->left->var) : getIntVar(node->var);
+            continue;
+        }
+        int count = operandCount(node);
+        for (int i = count - 1; i >= 0; i--)
+            pushFrame(operandAt(node, i), NULL, 0, frame.value);
+    }
+}
+
+// Run a leaf task: convert each operand subtree with convertToCNF in the
+// worker's arena and combine the clauses
+void runLeafCnfTask(CnfWorker *worker, CnfTask *task)
+{
+    int count = task->last - task->first;
+    ClauseSet **operands = (ClauseSet **)malloc(count * sizeof(ClauseSet *));
+    for (int i = 0; i < count; i++)
+    {
+        Node *subtree = cloneTree(operandAt(task->node, task->first + i));
+        if (operandPolarity(task->node, task->first + i, task->polarity) < 0)
+        {
+            Node *notNode = createNode('~');
+            notNode->left = subtree;
+            subtree = notNode;
+        }
+        operands[i] = createClauseSet();
+        appendCnfTreeClauses(operands[i], convertToCNF(subtree), &worker->scratch, &worker->scratchCapacity);
+        resetArena(worker->arena);
+    }
+    task->result = combineClauseSets(operands, count, isConjunction(task->node, task->polarity), &worker->scratch,
+                                     &worker->scratchCapacity);
+    free(operands);
+}
+
+// Push a task onto a worker's deque and wake one idle worker for it
+void pushCnfTask(CnfPool *pool, int owner, CnfTask *task)
+{
+    TaskDeque *deque = &pool->deques[owner];
+    pthread_mutex_lock(&deque->lock);
+    deque->tasks[deque->tail++] = task;
+    pthread_mutex_unlock(&deque->lock);
+
+    pthread_mutex_lock(&pool->lock);
+    __atomic_add_fetch(&pool->queued, 1, __ATOMIC_RELEASE);
+    pthread_cond_signal(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+// Newest task of the worker's own deque, or else the oldest task of
+// another worker's
+CnfTask *takeCnfTask(CnfWorker *worker)
+{
+    CnfPool *pool = worker->pool;
+    TaskDeque *own = &pool->deques[worker->id];
+    CnfTask *task = NULL;
+
+    pthread_mutex_lock(&own->lock);
+    if (own->tail > own->head)
+        task = own->tasks[--own->tail];
+    pthread_mutex_unlock(&own->lock);
+
+    for (int i = 1; task == NULL && i < pool->numWorkers; i++)
+    {
+        TaskDeque *victim = &pool->deques[(worker->id + i) % pool->numWorkers];
+        pthread_mutex_lock(&victim->lock);
+        if (victim->tail > victim->head)
+        {
+            task = victim->tasks[victim->head++];
+            worker->steals++;
+        }
+        pthread_mutex_unlock(&victim->lock);
+    }
+    if (task != NULL)
+        __atomic_sub_fetch(&pool->queued, 1, __ATOMIC_ACQ_REL);
+    return task;
+}
+
+void *cnfWorker(void *arg)
+{
+    CnfWorker *worker = (CnfWorker *)arg;
+    CnfPool *pool = worker->pool;
+    NodeArena *previousArena = setCurrentArena(worker->arena);
+
+    while (!__atomic_load_n(&pool->done, __ATOMIC_ACQUIRE))
+    {
+        CnfTask *task = takeCnfTask(worker);
+        if (task == NULL)
+        {
+            // Nothing to steal: sleep until a task is forked or the root is done
+            pthread_mutex_lock(&pool->lock);
+            while (__atomic_load_n(&pool->queued, __ATOMIC_ACQUIRE) == 0 && !pool->done)
+                pthread_cond_wait(&pool->wake, &pool->lock);
+            pthread_mutex_unlock(&pool->lock);
+            continue;
+        }
+        worker->tasksRun++;
+
+        if (task->numChildren > 0)
+        {
+            // Fork: the first operands end up on top of the deque
+            task->pending = task->numChildren;
+            for (int i = task->numChildren - 1; i >= 0; i--)
+            {
+                CnfTask *child = task->children[i];
+                child->polarity = child->flipped ? -task->polarity : task->polarity;
+                pushCnfTask(pool, worker->id, child);
+            }
+            continue;
+        }
+
+        runLeafCnfTask(worker, task);
+
+        // Whoever finishes a task's last child combines the task
+        while (task->parent != NULL)
+        {
+            CnfTask *parent = task->parent;
+            if (__atomic_sub_fetch(&parent->pending, 1, __ATOMIC_ACQ_REL) != 0)
+                break;
+            ClauseSet **operands = (ClauseSet **)malloc(parent->numChildren * sizeof(ClauseSet *));
+            for (int i = 0; i < parent->numChildren; i++)
+                operands[i] = parent->children[i]->result;
+            parent->result = combineClauseSets(operands, parent->numChildren,
+                                               isConjunction(parent->node, parent->polarity), &worker->scratch,
+                                               &worker->scratchCapacity);
+            free(operands);
+            task = parent;
+        }
+        if (task->parent == NULL)
+        {
+            pthread_mutex_lock(&pool->lock);
+            __atomic_store_n(&pool->done, 1, __ATOMIC_RELEASE);
+            pthread_cond_broadcast(&pool->wake);
+            pthread_mutex_unlock(&pool->lock);
+        }
+    }
+
+    setCurrentArena(previousArena);
+    return NULL;
+}
+
+// Thread entry for the extra CNF workers
+void *cnfWorkerThread(void *arg)
+{
+    cnfWorker(arg);
+    releaseWorkStack();
+    return NULL;
+}
+
+// CNF of a tree by distribution on numThreads workers. Large subtrees are
+// split into tasks (see buildCnfTasks) and forked onto per-worker deques;
+// idle workers steal the oldest, largest tasks. Each worker converts its
+// subtrees with convertToCNF in its own node arena, and the clause lists
+// are merged in operand order, so the output does not depend on the
+// schedule and has the clauses of convertToCNF in the same order, up to
+// the order of literals within a clause. Variables are numbered in order
+// of appearance. stats may be NULL.
+DIMACSFormula *parallelConvertToDIMACS(Node *root, int numThreads, ParallelCnfStats *stats)
+{
+    DIMACSFormula *formula = createDIMACS(DIMACS_CLAUSE_LIST);
+    if (stats != NULL)
+        memset(stats, 0, sizeof(ParallelCnfStats));
+
+    resetVarMapping();
+    if (root == NULL)
+        return formula;
+
+    // Number every variable first: workers only look numbers up
+    int varCount = 0;
+    int *vars = collectVariables(root, &varCount);
+    for (int i = 0; i < varCount; i++)
+    {
+        getIntVar(vars[i]);
+    }
+    free(vars);
+    formula->numVars = varMap.size;
+
+    if (numThreads < 1)
+        numThreads = 1;
+    int numTasks = 0;
+    CnfTask *rootTask = buildCnfTasks(root, &numTasks);
+    ClauseSet *result;
+    int scratchCapacity = 64;
+    int *scratch = (int *)malloc(scratchCapacity * sizeof(int));
+
+    if (rootTask == NULL)
+    {
+        // Too small to split
+        NodeArena *arena = createArena();
+        NodeArena *previousArena = setCurrentArena(arena);
+        Node *subtree = cloneTree(root);
+        result = createClauseSet();
+        appendCnfTreeClauses(result, convertToCNF(subtree), &scratch, &scratchCapacity);
+        setCurrentArena(previousArena);
+        destroyArena(arena);
+    }
+    else
+    {
+        CnfPool pool;
+        pool.numWorkers = numThreads;
+        pool.queued = 0;
+        pool.done = 0;
+        pthread_mutex_init(&pool.lock, NULL);
+        pthread_cond_init(&pool.wake, NULL);
+        pool.deques = (TaskDeque *)malloc(numThreads * sizeof(TaskDeque));
+        CnfWorker *workers = (CnfWorker *)calloc(numThreads, sizeof(CnfWorker));
+        for (int i = 0; i < numThreads; i++)
+        {
+            pool.deques[i].tasks = (CnfTask **)malloc(numTasks * sizeof(CnfTask *));
+            pool.deques[i].head = pool.deques[i].tail = 0;
+            pthread_mutex_init(&pool.deques[i].lock, NULL);
+            workers[i].pool = &pool;
+            workers[i].id = i;
+            workers[i].arena = createArena();
+            workers[i].scratchCapacity = 64;
+            workers[i].scratch = (int *)malloc(64 * sizeof(int));
+        }
+        rootTask->polarity = 1;
+        pushCnfTask(&pool, 0, rootTask);
+
+        pthread_t *threads = (pthread_t *)malloc(numThreads * sizeof(pthread_t));
+        int started = 0;
+        for (int i = 1; i < numThreads; i++)
+        {
+            if (pthread_create(&threads[started], NULL, cnfWorkerThread, &workers[i]) == 0)
+                started++;
+        }
+
+        // The calling thread works too
+        cnfWorker(&workers[0]);
+
+        for (int i = 0; i < started; i++)
+        {
+            pthread_join(threads[i], NULL);
+        }
+
+        result = rootTask->result;
+        if (stats != NULL)
+        {
+            stats->tasks = numTasks;
+            for (int i = 0; i < numThreads; i++)
+                stats->steals += workers[i].steals;
+        }
+        for (int i = 0; i < numThreads; i++)
+        {
+            free(pool.deques[i].tasks);
+            pthread_mutex_destroy(&pool.deques[i].lock);
+            destroyArena(workers[i].arena);
+            free(workers[i].scratch);
+        }
+        pthread_mutex_destroy(&pool.lock);
+        pthread_cond_destroy(&pool.wake);
+        free(threads);
+        free(workers);
+        free(pool.deques);
+        freeCnfTasks(rootTask);
+    }
+
+    formula->clauses = (Clause *)malloc((result->numClauses > 0 ? result->numClauses : 1) * sizeof(Clause));
+    formula->numClauses = result->numClauses;
+    for (int c = 0; c < result->numClauses; c++)
+    {
+        int size = result->start[c + 1] - result->start[c];
+        formula->clauses[c].literals = (int *)malloc((size > 0 ? size : 1) * sizeof(int));
+        memcpy(formula->clauses[c].literals, &result->literals[result->start[c]], size * sizeof(int));
+        formula->clauses[c].size = size;
+    }
+
+    freeClauseSet(result);
+    free(scratch);
+    return formula;
+}
+
+// ========== FUSED CNF ==========
+
+#define CNF_FUSED 6 // Distribution in one pass, no intermediate trees (equivalent)
+
+// Make room for more clauses and literals on a clause stack
+void reserveClauseStack(ClauseStack *stack, int clauses, int literals)
+{
+    if (stack->numClauses + clauses >= stack->clauseCapacity)
+    {
+        while (stack->numClauses + clauses >= stack->clauseCapacity)
+            stack->clauseCapacity *= 2;
+        stack->start = (int *)realloc(stack->start, (stack->clauseCapacity + 1) * sizeof(int));
+    }
+    if (stack->numLiterals + literals > stack->literalCapacity)
+    {
+        while (stack->numLiterals + literals > stack->literalCapacity)
+            stack->literalCapacity *= 2;
+        stack->literals = (int *)realloc(stack->literals, stack->literalCapacity * sizeof(int));
+    }
+}
+
+// Replace the count clause lists on top of the stack (list i starts at
+// clause first[i], the last one ends at the top) by their cross product.
+// Lists of one clause each are already one clause once their boundaries
+// are dropped; otherwise the product is written above them, with the last
+// list varying fastest, and moved down.
+void multiplyClauseStack(ClauseStack *stack, const int *first, int count)
+{
+    int end = stack->numClauses;
+    bool single = true;
+    for (int i = 0; i < count && single; i++)
+        single = (i + 1 < count ? first[i + 1] : end) - first[i] == 1;
+    if (single)
+    {
+        stack->numClauses = first[0] + 1;
+        stack->start[stack->numClauses] = stack->numLiterals;
+        return;
+    }
+
+    for (int i = 0; i < count; i++)
+        if ((i + 1 < count ? first[i + 1] : end) == first[i])
+        {
+            // An empty list is true, and so is the product
+            stack->numClauses = first[0];
+            stack->numLiterals = stack->start[first[0]];
+            return;
+        }
+
+    int *choice = (int *)malloc(count * sizeof(int));
+    for (int i = 0; i < count; i++)
+        choice[i] = first[i];
+    while (1)
+    {
+        int size = 0;
+        for (int i = 0; i < count; i++)
+            size += stack->start[choice[i] + 1] - stack->start[choice[i]];
+        reserveClauseStack(stack, 1, size);
+        for (int i = 0; i < count; i++)
+        {
+            int length = stack->start[choice[i] + 1] - stack->start[choice[i]];
+            memcpy(&stack->literals[stack->numLiterals], &stack->literals[stack->start[choice[i]]], length * sizeof(int));
+            stack->numLiterals += length;
+        }
+        stack->start[++stack->numClauses] = stack->numLiterals;
+
+        int i = count - 1;
+        while (i >= 0 && ++choice[i] == (i + 1 < count ? first[i + 1] : end))
+        {
+            choice[i] = first[i];
+            i--;
+        }
+        if (i < 0)
+            break;
+    }
+    free(choice);
+
+    // Move the product down over its operands
+    int from = stack->start[end], to = stack->start[first[0]];
+    int products = stack->numClauses - end;
+    memmove(&stack->literals[to], &stack->literals[from], (stack->numLiterals - from) * sizeof(int));
+    for (int j = 0; j <= products; j++)
+        stack->start[first[0] + j] = stack->start[end + j] - (from - to);
+    stack->numClauses = first[0] + products;
+    stack->numLiterals = stack->start[stack->numClauses];
+}
+
+// Push the clauses of a subtree under a polarity onto the stack, by
+// distribution in one post-order pass: negations and '>' are resolved
+// through the polarity, and no nodes are built. The operand lists of a
+// conjunction are already adjacent, so it costs nothing.
+void distributeOntoClauseStack(ClauseStack *stack, Node *subtree, int polarity)
+{
+    // First clause of each list waiting for its operator
+    int capacity = 64, top = 0;
+    int *first = (int *)malloc(capacity * sizeof(int));
+
+    int base = walkStack.top;
+    pushFrame(subtree, NULL, 0, polarity);
+    Node *node;
+    while ((node = nextPlanNode(base, &polarity)) != NULL)
+    {
+        if (!isOperator(node->value))
+        {
+            if (top == capacity)
+            {
+                capacity *= 2;
+                first = (int *)realloc(first, capacity * sizeof(int));
+            }
+            reserveClauseStack(stack, 1, 1);
+            first[top++] = stack->numClauses;
+            stack->literals[stack->numLiterals++] = polarity * getIntVar(node->var);
+            stack->start[++stack->numClauses] = stack->numLiterals;
+            continue;
+        }
+
+        int count = operandCount(node);
+        top -= count;
+        if (!isConjunction(node, polarity))
+            multiplyClauseStack(stack, &first[top], count);
+        top++;
+    }
+    free(first);
+}
+
+// CNF of a tree straight into DIMACS, replacing convertToCNF and
+// treeToDIMACS's four passes with one walk that carries a polarity.
+// Operands of the top-level conjunction (AND, or a negated OR or '>')
+// emit their clauses into the formula directly; only the disjunctions
+// below it go through a clause stack. The clauses are convertToCNF's.
+// Variables are numbered in order of appearance.
+DIMACSFormula *fusedToDIMACS(Node *root)
+{
+    DIMACSFormula *formula = createDIMACS(DIMACS_CLAUSE_LIST);
+    int capacity = 0;
+
+    resetVarMapping();
+    if (root == NULL)
+        return formula;
+
+    int varCount = 0;
+    int *vars = collectVariables(root, &varCount);
+    for (int i = 0; i < varCount; i++)
+    {
+        getIntVar(vars[i]);
+    }
+    free(vars);
+
+    ClauseStack stack;
+    stack.clauseCapacity = 64;
+    stack.literalCapacity = 256;
+    stack.start = (int *)malloc((stack.clauseCapacity + 1) * sizeof(int));
+    stack.literals = (int *)malloc(stack.literalCapacity * sizeof(int));
+
+    int base = walkStack.top;
+    pushFrame(root, NULL, 0, 1);
+    while (walkStack.top > base)
+    {
+        WalkFrame frame = popFrame();
+        Node *node = frame.node;
+        int polarity = frame.value;
+
+        if (!isOperator(node->value))
+        {
+            int literal = polarity * getIntVar(node->var);
+            appendClause(formula, &capacity, &literal, 1);
+            continue;
+        }
+        if (isConjunction(node, polarity))
+        {
+            int count = operandCount(node);
+            for (int i = count - 1; i >= 0; i--)
+                pushFrame(operandAt(node, i), NULL, 0, operandPolarity(node, i, polarity));
+            continue;
+        }
+
+        stack.numClauses = 0;
+        stack.numLiterals = 0;
+        stack.start[0] = 0;
+        distributeOntoClauseStack(&stack, node, polarity);
+        for (int c = 0; c < stack.numClauses; c++)
+            appendClause(formula, &capacity, &stack.literals[stack.start[c]], stack.start[c + 1] - stack.start[c]);
+    }
+    formula->numVars = varMap.size;
+
+    free(stack.start);
+    free(stack.literals);
+    return formula;
+}
+
+// Convert a tree to DIMACS with CNF_DISTRIBUTE, CNF_TSEITIN,
+// CNF_PLAISTED_GREENBAUM, CNF_CLAUSE_SET, CNF_PLANNED (with clause budget
+// budget, which the other modes ignore), CNF_PARALLEL (on every core) or
+// CNF_FUSED. The tree is left untouched.
+DIMACSFormula *convertToDIMACS(Node *root, int mode, long long budget)
+{
+    if (mode == CNF_TSEITIN)
+        return tseitinToDIMACS(root);
+    if (mode == CNF_PLAISTED_GREENBAUM)
+        return plaistedGreenbaumToDIMACS(root);
+    if (mode == CNF_CLAUSE_SET)
+        return clauseSetToDIMACS(root, NULL);
+    if (mode == CNF_PLANNED)
+    {
+        CnfPlan *plan = planCNF(root, budget);
+        DIMACSFormula *formula = plannedToDIMACS(root, plan);
+        freeCnfPlan(plan);
+        return formula;
+    }
+    if (mode == CNF_PARALLEL)
+        return parallelConvertToDIMACS(root, availableCores(), NULL);
+    if (mode == CNF_FUSED)
+        return fusedToDIMACS(root);
+
+    Node *cnfTree = convertToCNF(cloneTree(root));
+    DIMACSFormula *formula = treeToDIMACS(cnfTree);
+    freeTree(cnfTree);
+    return formula;
+}
+
+// Print DIMACS format
+void printDIMACS(DIMACSFormula *formula)
+{
+    printf("c DIMACS CNF Format\n");
+    printf("c Generated from parse tree\n");
+    printf("p cnf %d %d\n", formula->numVars, formula->numClauses);
+
+    for (int i = 0; i < formula->numClauses; i++)
+    {
+        for (int j = 0; j < dimacsClauseSize(formula, i); j++)
+        {
+            printf("%d ", dimacsLiteral(formula, i, j));
+        }
+        printf("0\n");
+    }
+}
+
+// Save DIMACS to file
+void saveDIMACS(DIMACSFormula *formula, const char *filename)
+{
+    FILE *file = fopen(filename, "w");
+    if (file == NULL)
+    {
+        printf("Error: Cannot open file %s\n", filename);
+        return;
+    }
+
+    fprintf(file, "c DIMACS CNF Format\n");
+    fprintf(file, "c Generated from parse tree\n");
+    fprintf(file, "p cnf %d %d\n", formula->numVars, formula->numClauses);
+
+    for (int i = 0; i < formula->numClauses; i++)
+    {
+        for (int j = 0; j < dimacsClauseSize(formula, i); j++)
+        {
+            fprintf(file, "%d ", dimacsLiteral(formula, i, j));
+        }
+        fprintf(file, "0\n");
+    }
+
+    fclose(file);
+    printf("DIMACS formula saved to %s\n", filename);
+}
+
+// Byte offset to 1-based line number, for error messages
+int dimacsLineAt(const char *text, const char *at)
+{
+    int line = 1;
+    for (const char *p = text; p < at; p++)
+        line += *p == '\n';
+    return line;
+}
+
+// Scan the clauses of one chunk. Integers are parsed by hand and a clause
+// ends at its 0, not at a newline, so clauses may span lines and chunks.
+void scanDIMACSChunk(DimacsChunk *chunk)
+{
+    const char *p = chunk->begin;
+    const char *end = chunk->end;
+    unsigned long long numVars = chunk->numVars;
+
+    long long reserve = (long long)(end - p) / 2 + 1;
+    if (reserve > chunk->maxClauses + 1)
+        reserve = chunk->maxClauses + 1;
+    chunk->clauseCapacity = reserve;
+    chunk->clauseEnds = (size_t *)malloc((reserve + 1) * sizeof(size_t));
+    chunk->clauseEnds[0] = 0;
+    chunk->literalCapacity = 1024;
+    chunk->literals = (int *)malloc(chunk->literalCapacity * sizeof(int));
+
+    while (1)
+    {
+        while (p < end && (unsigned char)*p <= ' ')
+            p++;
+        if (p == end)
+            break;
+
+        char c = *p;
+        if (c == 'c')
+        {
+            // Comment: skip the rest of the line
+            const char *newline = (const char *)memchr(p, '\n', end - p);
+            p = newline != NULL ? newline + 1 : end;
+            continue;
+        }
+        if (c == '%')
+        {
+            // SATLIB end marker: nothing after it counts
+            chunk->stopped = true;
+            chunk->end = p;
+            break;
+        }
+
+        chunk->errorAt = p;
+        if (c == 'p')
+        {
+            chunk->error = "second p cnf header";
+            break;
+        }
+
+        // One literal: optional sign, then digits
+        bool negative = c == '-';
+        p += negative;
+        unsigned long long value = 0;
+        const char *digits = p;
+        while (p < end && (unsigned char)(*p - '0') < 10)
+            value = value * 10 + (unsigned char)(*p++ - '0');
+        if (p == digits || (p < end && (unsigned char)*p > ' '))
+        {
+            chunk->error = "expected an integer";
+            break;
+        }
+        // More than ten digits could have wrapped value around
+        if (p - digits > 10 || value > numVars)
+        {
+            chunk->error = "variable above the header's count";
+            break;
+        }
+
+        if (value == 0)
+        {
+            // End of clause; its literals are already in place
+            if (chunk->numClauses == chunk->maxClauses)
+            {
+                chunk->error = "more clauses than the header declares";
+                break;
+            }
+            chunk->clauseEnds[++chunk->numClauses] = chunk->numLiterals;
+            continue;
+        }
+
+        if (chunk->numLiterals == chunk->literalCapacity)
+        {
+            chunk->literalCapacity *= 2;
+            chunk->literals = (int *)realloc(chunk->literals, chunk->literalCapacity * sizeof(int));
+        }
+        chunk->literals[chunk->numLiterals++] = negative ? -(int)value : (int)value;
+    }
+}
+
+void *scanDIMACSChunkThread(void *arg)
+{
+    scanDIMACSChunk((DimacsChunk *)arg);
+    return NULL;
+}
+
+// Copy a scanned chunk's literals and clause ends into the formula at the
+// offsets the prefix sums gave it
+void *placeDIMACSChunkThread(void *arg)
+{
+    DimacsChunk *chunk = (DimacsChunk *)arg;
+    memcpy(chunk->formula->literals + chunk->literalOffset, chunk->literals, chunk->numLiterals * sizeof(int));
+    for (long long k = 1; k <= chunk->numClauses; k++)
+    {
+        chunk->formula->clauseStart[chunk->clauseOffset + k] = chunk->literalOffset + chunk->clauseEnds[k];
+    }
+    return NULL;
+}
+
+// Run fn on every chunk, the first on the calling thread
+void runDIMACSChunks(DimacsChunk *chunks, int numChunks, void *(*fn)(void *))
+{
+    pthread_t *threads = (pthread_t *)malloc(numChunks * sizeof(pthread_t));
+    bool *started = (bool *)calloc(numChunks, sizeof(bool));
+    for (int i = 1; i < numChunks; i++)
+    {
+        started[i] = pthread_create(&threads[i], NULL, fn, &chunks[i]) == 0;
+    }
+    fn(&chunks[0]);
+    for (int i = 1; i < numChunks; i++)
+    {
+        if (started[i])
+            pthread_join(threads[i], NULL);
+        else
+            fn(&chunks[i]);
+    }
+    free(started);
+    free(threads);
+}
+
+#define DIMACS_MIN_CHUNK (1 << 20) // Smallest stretch of text worth its own thread
+
+// Read DIMACS from file in the given layout, on up to numThreads threads.
+// The file is opened with openFileView and its clauses cut into chunks
+// at line starts; each chunk is scanned into its own buffer, and prefix
+// sums over the chunks' literal and clause counts place the buffers in
+// order. The clause and variable counts must agree with the "p cnf"
+// header. A problem found by several threads is reported by scanning
+// again on one, so the message is the one a sequential read gives.
+// Returns NULL on error.
+DIMACSFormula *readDIMACSParallel(const char *filename, int layout, int numThreads)
+{
+    FileView view;
+    if (!openFileView(filename, &view, true))
+        return NULL;
+    if (view.size == 0)
+    {
+        printf("Error: %s has no p cnf header\n", filename);
+        closeFileView(&view);
+        return NULL;
+    }
+
+    const char *text = view.data;
+    const char *p = text;
+    const char *end = text + view.size;
+    const char *error = NULL;
+    const char *errorAt = NULL;
+    long long numVars = -1, expectedClauses = 0;
+
+    // Comments, then the header
+    while (1)
+    {
+        while (p < end && (unsigned char)*p <= ' ')
+            p++;
+        if (p < end && *p == 'c')
+        {
+            const char *newline = (const char *)memchr(p, '\n', end - p);
+            p = newline != NULL ? newline + 1 : end;
+            continue;
+        }
+        break;
+    }
+    errorAt = p;
+    if (p == end || *p == '%')
+        error = "missing p cnf header";
+    else if (*p != 'p')
+        error = "clause before the p cnf header";
+    else
+    {
+        // Copy the header line out so sscanf cannot run past the map
+        char header[128];
+        size_t length = 0;
+        while (p < end && *p != '\n' && length < sizeof(header) - 1)
+            header[length++] = *p++;
+        header[length] = '\0';
+        char rest;
+        if (sscanf(header, "p cnf %lld %lld %c", &numVars, &expectedClauses, &rest) != 2 || numVars < 0 ||
+            numVars > INT_MAX || expectedClauses < 0 || expectedClauses > INT_MAX)
+            error = "malformed p cnf header";
+    }
+
+    // Cut the rest at line starts
+    int numChunks = 1;
+    if (error == NULL && numThreads > 1)
+    {
+        size_t worthwhile = (end - p) / DIMACS_MIN_CHUNK + 1;
+        numChunks = worthwhile < (size_t)numThreads ? (int)worthwhile : numThreads;
+    }
+    DimacsChunk *chunks = (DimacsChunk *)calloc(numChunks, sizeof(DimacsChunk));
+    const char *begin = p;
+    for (int i = 0; i < numChunks; i++)
+    {
+        const char *cut = end;
+        if (i + 1 < numChunks)
+        {
+            cut = p + (end - p) / numChunks * (i + 1);
+            const char *newline = cut < end ? (const char *)memchr(cut, '\n', end - cut) : NULL;
+            cut = newline != NULL ? newline + 1 : end;
+            if (cut < begin)
+                cut = begin;
+        }
+        chunks[i].begin = begin;
+        chunks[i].end = cut;
+        chunks[i].numVars = (int)numVars;
+        chunks[i].maxClauses = expectedClauses;
+        begin = cut;
+    }
+
+    DIMACSFormula *formula = createDIMACS(layout);
+    if (error == NULL)
+    {
+        runDIMACSChunks(chunks, numChunks, scanDIMACSChunkThread);
+
+        // Prefix sums, up to the first chunk that hit the end marker
+        size_t numLiterals = 0;
+        long long numClauses = 0;
+        int used = 0;
+        while (used < numChunks && error == NULL)
+        {
+            DimacsChunk *chunk = &chunks[used++];
+            chunk->literalOffset = numLiterals;
+            chunk->clauseOffset = numClauses;
+            chunk->formula = formula;
+            numLiterals += chunk->numLiterals;
+            numClauses += chunk->numClauses;
+            error = chunk->error;
+            errorAt = chunk->errorAt;
+            if (chunk->stopped)
+                break;
+        }
+
+        if (error == NULL)
+        {
+            size_t lastEnd = 0;
+            for (int i = used - 1; i >= 0 && lastEnd == 0; i--)
+            {
+                if (chunks[i].numClauses > 0)
+                    lastEnd = chunks[i].literalOffset + chunks[i].clauseEnds[chunks[i].numClauses];
+            }
+            errorAt = chunks[used - 1].end;
+            if (numLiterals > lastEnd)
+                error = "last clause has no terminating 0";
+            else if (numClauses > expectedClauses)
+                error = "more clauses than the header declares";
+            else if (numClauses < expectedClauses)
+                error = "fewer clauses than the header declares";
+        }
+
+        if (error != NULL && numChunks > 1)
+        {
+            // Where several chunks disagree with the file as a whole, one
+            // sequential pass knows which problem comes first
+            for (int i = 0; i < numChunks; i++)
+            {
+                free(chunks[i].literals);
+                free(chunks[i].clauseEnds);
+            }
+            free(chunks);
+            closeFileView(&view);
+            free(formula);
+            return readDIMACSParallel(filename, layout, 1);
+        }
+
+        if (error == NULL)
+        {
+            formula->numVars = (int)numVars;
+            formula->numClauses = (int)numClauses;
+            if (numChunks == 1)
+            {
+                // Nothing to move: keep the chunk's own buffers
+                formula->literals =
+                    (int *)realloc(chunks[0].literals, (numLiterals > 0 ? numLiterals : 1) * sizeof(int));
+                formula->clauseStart = chunks[0].clauseEnds;
+                chunks[0].literals = NULL;
+                chunks[0].clauseEnds = NULL;
+            }
+            else
+            {
+                formula->literals = (int *)malloc((numLiterals > 0 ? numLiterals : 1) * sizeof(int));
+                formula->clauseStart = (size_t *)malloc((numClauses + 1) * sizeof(size_t));
+                formula->clauseStart[0] = 0;
+                runDIMACSChunks(chunks, used, placeDIMACSChunkThread);
+            }
+        }
+    }
+
+    for (int i = 0; i < numChunks; i++)
+    {
+        free(chunks[i].literals);
+        free(chunks[i].clauseEnds);
+    }
+    free(chunks);
+
+    if (error != NULL)
+    {
+        printf("Error: %s line %d: %s\n", filename, dimacsLineAt(text, errorAt), error);
+        closeFileView(&view);
+        free(formula);
+        return NULL;
+    }
+    closeFileView(&view);
+
+    size_t *clauseStart = formula->clauseStart;
+    formula->clauseStart = NULL;
+    finishDIMACSLayout(formula, clauseStart, layout);
+
+    printf("DIMACS formula loaded: %d variables, %d clauses\n", formula->numVars, formula->numClauses);
+    return formula;
+}
+
+// Read DIMACS from file in the given layout
+DIMACSFormula *readDIMACSAs(const char *filename, int layout)
+{
+    return readDIMACSParallel(filename, layout, 1);
+}
+
+// Read DIMACS from file
+DIMACSFormula *readDIMACS(const char *filename)
+{
+    return readDIMACSAs(filename, DIMACS_CLAUSE_LIST);
+}
+
+// Evaluate DIMACS formula with assignment
+bool evaluateDIMACS(DIMACSFormula *formula, int *assignment)
+{
+    if (formula->layout == DIMACS_FLAT_PACKED)
+    {
+        // The low bit of a code is the sign, so a literal is true when it
+        // differs from its variable's value being false
+        const unsigned int *codes = (const unsigned int *)formula->literals;
+        const size_t *start = formula->clauseStart;
+        for (int i = 0; i < formula->numClauses; i++)
+        {
+            size_t k = start[i];
+            while (k < start[i + 1] && (assignment[codes[k] >> 1] != 0) == (codes[k] & 1))
+                k++;
+            if (k == start[i + 1])
+                return false;
+        }
+        return true;
+    }
+
+    if (formula->layout == DIMACS_FLAT)
+    {
+        const int *literals = formula->literals;
+        const size_t *start = formula->clauseStart;
+        for (int i = 0; i < formula->numClauses; i++)
+        {
+            size_t k = start[i];
+            while (k < start[i + 1] && (assignment[abs(literals[k])] != 0) != (literals[k] > 0))
+                k++;
+            if (k == start[i + 1])
+                return false;
+        }
+        return true;
+    }
+
+    // Formula is true if all clauses are true
+    for (int i = 0; i < formula->numClauses; i++)
+    {
+        bool clauseTrue = false;
+
+        // Clause is true if at least one literal is true
+        for (int j = 0; j < formula->clauses[i].size; j++)
+        {
+            int lit = formula->clauses[i].literals[j];
+            int var = abs(lit);
+            bool value = assignment[var];
+
+            // Check if literal is satisfied
+            if ((lit > 0 && value) || (lit < 0 && !value))
+            {
+                clauseTrue = true;
+                break;
+            }
+        }
+
+        if (!clauseTrue)
+        {
+            return false; // Formula is false
+        }
+    }
+
+    return true; // All clauses satisfied
+}
+
+// Print variable mapping
+void printVarMapping()
+{
+    printf("\nVariable Mapping:\n");
+    printf("Name -> Integer\n");
+    for (int i = 1; i <= varMap.size; i++)
+    {
+        bool aux = varMap.firstAux > 0 && i >= varMap.firstAux;
+        printf("  %s   ->   %d%s\n", getVarName(i), i, aux ? "   (auxiliary)" : "");
+    }
+}
+
+
+
+// Free DIMACS formula
+void freeDIMACS(DIMACSFormula *formula)
+{
+    if (formula == NULL)
+        return;
+
+    if (formula->literals != NULL)
+    {
+        free(formula->literals);
+    }
+    else
+    {
+        for (int i = 0; i < formula->numClauses; i++)
+        {
+            free(formula->clauses[i].literals);
+        }
+    }
+    free(formula->clauses);
+    free(formula->clauseStart);
+    free(formula);
+}
+
+// Free the tree. Left children are rotated up into the right spine, so
+// arbitrarily deep trees are released without recursion; operands of n-ary
+// nodes wait on the work stack. Nodes owned by an arena are skipped; reset
+// or destroy the arena to release them.
+void freeTree(Node *root)
+{
+    int base = walkStack.top;
+
+    while (root != NULL || walkStack.top > base)
+    {
+        if (root == NULL)
+        {
+            root = popFrame().node;
+        }
+        else if (root->left != NULL)
+        {
+            Node *left = root->left;
+            root->left = left->right;
+            left->right = root;
+            root = left;
+        }
+        else
+        {
+            Node *next = root->right;
+            for (int i = root->numChildren - 1; i >= 0; i--)
+                pushFrame(root->children[i], NULL, 0, 0);
+            releaseChildren(root);
+            releaseNode(root);
+            root = next;
+        }
+    }
+}
+
+// Marks of the symbols already collected by collectVariables (per thread)
+_Thread_local char *symbolSeen = NULL;
+_Thread_local int symbolSeenCapacity = 0;
+
+// Collect the unique variables of the tree as symbol IDs, in order of first
+// appearance. Returns a malloc'd array (NULL when there are none).
+int *collectVariables(Node *root, int *count)
+{
+    *count = 0;
+    if (root == NULL)
+        return NULL;
+
+    int capacity = 16;
+    int *vars = (int *)malloc(capacity * sizeof(int));
+    int base = walkStack.top;
+    pushFrame(root, NULL, 0, 0);
+
+    while (walkStack.top > base)
+    {
+        Node *node = popFrame().node;
+
+        if (!isOperator(node->value))
+        {
+            int var = node->var;
+            if (var >= symbolSeenCapacity)
+            {
+                int newCapacity = symbolSeenCapacity > 0 ? symbolSeenCapacity : 64;
+                while (newCapacity <= var)
+                    newCapacity *= 2;
+                symbolSeen = (char *)realloc(symbolSeen, newCapacity);
+                memset(symbolSeen + symbolSeenCapacity, 0, newCapacity - symbolSeenCapacity);
+                symbolSeenCapacity = newCapacity;
+            }
+
+            // Check if already present
+            if (!symbolSeen[var])
+            {
+                symbolSeen[var] = 1;
+                if (*count == capacity)
+                {
+                    capacity *= 2;
+                    vars = (int *)realloc(vars, capacity * sizeof(int));
+                }
+                vars[(*count)++] = var;
+            }
+        }
+
+        for (int i = node->numChildren - 1; i >= 0; i--)
+            pushFrame(node->children[i], NULL, 0, 0);
+        if (node->right != NULL)
+            pushFrame(node->right, NULL, 0, 0);
+        if (node->left != NULL)
+            pushFrame(node->left, NULL, 0, 0);
+    }
+
+    // Clear only the marks that were set
+    for (int i = 0; i < *count; i++)
+    {
+        symbolSeen[vars[i]] = 0;
+    }
+    return vars;
+}
+
+
+// Count nodes in tree (explicit stack, parsed chains can be millions deep)
+void count_nodes(Node *root, int *node_count) {
+    if (!root) return;
+    int capacity = 1024, top = 0;
+    Node **stack = malloc(capacity * sizeof(Node *));
+    stack[top++] = root;
+    while (top > 0) {
+        Node *node = stack[--top];
+        (*node_count)++;
+        if (top + 2 > capacity) {
+            capacity *= 2;
+            stack = realloc(stack, capacity * sizeof(Node *));
+        }
+        if (top + node->numChildren + 2 > capacity) {
+            capacity = (top + node->numChildren + 2) * 2;
+            stack = realloc(stack, capacity * sizeof(Node *));
+        }
+        for (int i = node->numChildren - 1; i >= 0; i--) stack[top++] = node->children[i];
+        if (node->right) stack[top++] = node->right;
+        if (node->left) stack[top++] = node->left;
+    }
+    free(stack);
+}
+
+// For testing, add timing
+double get_time() {
+    return (double)clock() / CLOCKS_PER_SEC;
+}
+
+// Wall-clock time, clock() adds up CPU time of all threads
+double get_wall_time() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Generate test formula of length n (simple chain)
+void generate_formula(char *formula, int n) {
+    int pos = 0;
+    formula[pos++] = '(';
+    for (int i = 0; i < n / 2; i++) {
+        formula[pos++] = 'p';
+        if (i < n / 2 - 1) formula[pos++] = '+';
+    }
+    formula[pos++] = ')';
+    formula[pos] = '\0';
+}
+
+// Generate a fully parenthesized left-deep formula nested depth levels:
+// (((p+~q)+q)+~q)... with every fourth level wrapped in a double negation.
+// Only ORs, so the CNF stays linear and every pass walks the full depth.
+char *generate_nested_formula(int depth) {
+    char *formula = malloc((size_t)depth * 10 + 2);
+    int pos = 0;
+    for (int i = depth - 1; i >= 0; i--) {
+        if (i % 4 == 3) {
+            // Parenthesized so the negation does not swallow the enclosing chain
+            memcpy(formula + pos, "(~(~(", 5);
+            pos += 5;
+        } else {
+            formula[pos++] = '(';
+        }
+    }
+    formula[pos++] = 'p';
+    for (int i = 0; i < depth; i++) {
+        formula[pos++] = '+';
+        if (i % 2 == 0) formula[pos++] = '~';
+        formula[pos++] = 'q';
+        formula[pos++] = ')';
+        if (i % 4 == 3) {
+            formula[pos++] = ')';
+            formula[pos++] = ')';
+        }
+    }
+    formula[pos] = '\0';
+    return formula;
+}
+
+// Test deep nesting: every walk must survive depths far past the C stack
+void test_deep_nesting(int max_depth) {
+    printf("Testing Deeply Nested Formulas\n");
+    printf("depth,parse_sec,height,height_sec,clone_sec,prefix_sec,eval_sec,cnf_sec,free_sec\n");
+    for (int depth = 1000; depth <= max_depth; depth *= 10) {
+        char *formula = generate_nested_formula(depth);
+
+        double t0 = get_wall_time();
+        Node *tree = buildParseTree(formula);
+        double t1 = get_wall_time();
+        int height = calculateHeight(tree);
+        double t2 = get_wall_time();
+
+        char *prefix = malloc((size_t)depth * 8 + 4);
+        int prefixIndex = 0;
+        treeToPrefix(tree, prefix, &prefixIndex);
+        double t3 = get_wall_time();
+
+        TruthAssignment assignments[2] = {{findSymbol("p"), 1}, {findSymbol("q"), 0}};
+        evaluateFormula(tree, assignments, 2);
+        double t4 = get_wall_time();
+
+        // Only one tree is kept alive at a time to bound memory at 10^7 levels
+        Node *copy = cloneTree(tree);
+        double t5 = get_wall_time();
+        freeTree(tree);
+
+        double t6 = get_wall_time();
+        Node *cnf = convertToCNF(copy);
+        double t7 = get_wall_time();
+        freeTree(cnf);
+        double t8 = get_wall_time();
+
+        printf("%d,%.6f,%d,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f\n", depth, t1 - t0, height, t2 - t1,
+               t5 - t4, t3 - t2, t4 - t3, t7 - t6, t8 - t7);
+        fflush(stdout);
+        free(prefix);
+        free(formula);
+    }
+}
+
+// Test parsing (n grows geometrically, time per char should stay flat)
+void test_parsing(int max_n) {
+    printf("Testing Parsing Time and Space\n");
+    printf("n,time_sec,nodes,ns_per_char\n");
+    for (int n = 10; n <= max_n; n *= 10) {
+        char *formula = malloc(n + 2);
+        generate_formula(formula, n);
+
+        clock_t start = clock();
+        Node *tree = buildParseTree(formula);
+        clock_t end = clock();
+
+        double time_taken = (double)(end - start) / CLOCKS_PER_SEC;
+
+        // Count nodes (space approx)
+        int node_count = 0;
+        count_nodes(tree, &node_count);
+
+        printf("%d,%.6f,%d,%.2f\n", n, time_taken, node_count, time_taken * 1e9 / n);
+        freeTree(tree);
+        free(formula);
+    }
+}
+
+// Test batch parsing throughput (formulas/sec versus thread count)
+void test_batch_parsing(int num_formulas, int formula_len, int max_threads) {
+    printf("Testing Batch Parsing Throughput (%d formulas of %d chars)\n", num_formulas, formula_len);
+    printf("threads,time_sec,formulas_per_sec,speedup\n");
+
+    char **formulas = malloc(num_formulas * sizeof(char *));
+    for (int i = 0; i < num_formulas; i++) {
+        formulas[i] = malloc(formula_len + 2);
+        generate_formula(formulas[i], formula_len);
+    }
+    Node **results = malloc(num_formulas * sizeof(Node *));
+
+    double base_time = 0;
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        double start = get_wall_time();
+        parseFormulasBatch(formulas, num_formulas, results, NULL, threads);
+        double time_taken = get_wall_time() - start;
+
+        if (threads == 1) base_time = time_taken;
+        printf("%d,%.6f,%.0f,%.2f\n", threads, time_taken, num_formulas / time_taken, base_time / time_taken);
+
+        for (int i = 0; i < num_formulas; i++) freeTree(results[i]);
+    }
+
+    for (int i = 0; i < num_formulas; i++) free(formulas[i]);
+    free(formulas);
+    free(results);
+}
+
+// Test CNF conversion
+void test_cnf(int max_n) {
+    printf("Testing CNF Conversion Time and Space (malloc vs arena)\n");
+    printf("n,time_sec,nodes,allocs,peak_bytes,arena_time_sec,arena_allocs,arena_peak_bytes\n");
+    for (int n = 10; n <= max_n; n += 10) {
+        char formula[2000];
+        generate_formula(formula, n);
+
+        Node *tree = buildParseTree(formula);
+
+        // One malloc per node
+        resetNodeStats();
+        long base_bytes = nodeStats.currentBytes;
+        clock_t start = clock();
+        Node *cnf = convertToCNF(cloneTree(tree));
+        clock_t end = clock();
+
+        double time_taken = (double)(end - start) / CLOCKS_PER_SEC;
+        long allocs = nodeStats.allocations;
+        long peak = nodeStats.peakBytes - base_bytes;
+
+        int node_count = 0;
+        count_nodes(cnf, &node_count);
+        freeTree(cnf);
+
+        // Same pipeline on an arena, released with one call
+        NodeArena *arena = createArena();
+        resetNodeStats();
+        base_bytes = nodeStats.currentBytes;
+        NodeArena *previous = setCurrentArena(arena);
+        start = clock();
+        cnf = convertToCNF(cloneTree(tree));
+        end = clock();
+        setCurrentArena(previous);
+
+        double arena_time = (double)(end - start) / CLOCKS_PER_SEC;
+        long arena_allocs = nodeStats.allocations;
+        long arena_peak = nodeStats.peakBytes - base_bytes;
+        destroyArena(arena);
+
+        printf("%d,%.6f,%d,%ld,%ld,%.6f,%ld,%ld\n", n, time_taken, node_count, allocs, peak,
+               arena_time, arena_allocs, arena_peak);
+        freeTree(tree);
+    }
+}
+
+// Generate an OR of k two-variable ANDs, k <= 13: ((a*b)+(c*d)+...) as one
+// chain, or (((a*b)+(c*d))+...) fully parenthesized when nested is set
+void generate_or_of_ands(char *formula, int k, bool nested) {
+    int pos = 0;
+    for (int i = 0; i < (nested ? k - 1 : 1); i++) formula[pos++] = '(';
+    for (int i = 0; i < k; i++) {
+        if (i > 0) formula[pos++] = '+';
+        formula[pos++] = '(';
+        formula[pos++] = 'a' + 2 * i;
+        formula[pos++] = '*';
+        formula[pos++] = 'a' + 2 * i + 1;
+        formula[pos++] = ')';
+        if (nested && i > 0) formula[pos++] = ')';
+    }
+    if (!nested) formula[pos++] = ')';
+    formula[pos] = '\0';
+}
+
+// Test hash-consed CNF: tree distribution versus the shared DAG
+void test_hash_consing(int max_k) {
+    printf("Testing Hash-Consed CNF (OR of k ANDs)\n");
+    printf("k,tree_sec,tree_nodes,dag_sec,dag_nodes,dag_edges,dag_expanded_nodes,memory_saved_pct\n");
+    for (int k = 1; k <= max_k; k++) {
+        char formula[200];
+        generate_or_of_ands(formula, k, true);
+        Node *tree = buildParseTree(formula);
+
+        double start = get_wall_time();
+        Node *cnf = convertToCNF(cloneTree(tree));
+        double tree_time = get_wall_time() - start;
+        int tree_nodes = 0;
+        count_nodes(cnf, &tree_nodes);
+        freeTree(cnf);
+
+        HashConsTable *table = createHashConsTable();
+        start = get_wall_time();
+        Node *shared = convertToCNFShared(table, tree);
+        double dag_time = get_wall_time() - start;
+
+        long dag_nodes, dag_edges;
+        double expanded;
+        countSharing(shared, &dag_nodes, &dag_edges, &expanded);
+
+        printf("%d,%.6f,%d,%.6f,%ld,%ld,%.0f,%.1f\n", k, tree_time, tree_nodes, dag_time,
+               dag_nodes, dag_edges, expanded, 100.0 * (1.0 - dag_nodes / expanded));
+        destroyHashConsTable(table);
+        freeTree(tree);
+    }
+}
+
+// Test flat (struct-of-arrays) trees against pointer trees
+void test_flat_tree(int max_depth) {
+    printf("Testing Flat Tree Layout (pointer_sec / flat_sec per walk)\n");
+    printf("depth,nodes,flatten_sec,eval_ptr,eval_flat,height_ptr,height_flat,prefix_ptr,prefix_flat,infix_ptr,infix_flat,match\n");
+    for (int depth = 1000; depth <= max_depth; depth *= 10) {
+        char *formula = generate_nested_formula(depth);
+        Node *tree = buildParseTree(formula);
+        int nodes = 0;
+        count_nodes(tree, &nodes);
+
+        double t0 = get_wall_time();
+        FlatTree *flat = flattenTree(tree);
+        double flatten_time = get_wall_time() - t0;
+
+        TruthAssignment assignments[2] = {{findSymbol("p"), 0}, {findSymbol("q"), 1}};
+        char *buffer_ptr = malloc((size_t)nodes * 4 + 4);
+        char *buffer_flat = malloc((size_t)nodes * 4 + 4);
+        int len_ptr = 0, len_flat = 0;
+        double times[8];
+
+        t0 = get_wall_time();
+        int eval_ptr = evaluateFormula(tree, assignments, 2);
+        times[0] = get_wall_time() - t0;
+        t0 = get_wall_time();
+        int eval_flat = evaluateFlat(flat, assignments, 2);
+        times[1] = get_wall_time() - t0;
+
+        t0 = get_wall_time();
+        int height_ptr = calculateHeight(tree);
+        times[2] = get_wall_time() - t0;
+        t0 = get_wall_time();
+        int height_flat = calculateFlatHeight(flat);
+        times[3] = get_wall_time() - t0;
+
+        t0 = get_wall_time();
+        treeToPrefix(tree, buffer_ptr, &len_ptr);
+        times[4] = get_wall_time() - t0;
+        t0 = get_wall_time();
+        flatToPrefix(flat, buffer_flat, &len_flat);
+        times[5] = get_wall_time() - t0;
+        bool match = eval_ptr == eval_flat && height_ptr == height_flat &&
+                     len_ptr == len_flat && memcmp(buffer_ptr, buffer_flat, len_ptr) == 0;
+
+        len_ptr = len_flat = 0;
+        t0 = get_wall_time();
+        treeToInfix(tree, buffer_ptr, &len_ptr);
+        times[6] = get_wall_time() - t0;
+        t0 = get_wall_time();
+        flatToInfix(flat, buffer_flat, &len_flat);
+        times[7] = get_wall_time() - t0;
+        match = match && len_ptr == len_flat && memcmp(buffer_ptr, buffer_flat, len_ptr) == 0;
+
+        // Round trip back to pointers must give the same prefix text
+        Node *back = unflattenTree(flat);
+        int len_back = 0, len_round = 0;
+        treeToPrefix(back, buffer_ptr, &len_back);
+        flatToPrefix(flat, buffer_flat, &len_round);
+        match = match && len_back == len_round && memcmp(buffer_ptr, buffer_flat, len_back) == 0;
+
+        printf("%d,%d,%.6f", depth, nodes, flatten_time);
+        for (int i = 0; i < 8; i++) printf(",%.6f", times[i]);
+        printf(",%s\n", match ? "yes" : "NO");
+        fflush(stdout);
+
+        freeTree(back);
+        freeFlatTree(flat);
+        freeTree(tree);
+        free(buffer_ptr);
+        free(buffer_flat);
+        free(formula);
+    }
+
+    // N-ary AND/OR nodes are chained in the flat form but keep their height
+    const char *nary[5] = {"(f+e+d+d)", "((a*b*c)+(d+e+f+g)+~(h*i*j*k*l))", "~(a*(b+c+(d*e*f*g)+h)*i)",
+                           "((a+b+c)>(d*e))", "(((a+b+c+d+e+f)*g)+h)"};
+    printf("nary_formula,height_ptr,height_flat,eval_match,match\n");
+    for (int i = 0; i < 5; i++) {
+        char formula[64];
+        strcpy(formula, nary[i]);
+        Node *tree = buildParseTree(formula);
+        FlatTree *flat = flattenTree(tree);
+        int height_ptr = calculateHeight(tree), height_flat = calculateFlatHeight(flat);
+        TruthAssignment assignments[12];
+        int varCount = 0;
+        int *vars = collectVariables(tree, &varCount);
+        for (int v = 0; v < varCount; v++) assignments[v] = (TruthAssignment){vars[v], v & 1};
+        bool eval_match = evaluateFormula(tree, assignments, varCount) == evaluateFlat(flat, assignments, varCount);
+        printf("%s,%d,%d,%s,%s\n", nary[i], height_ptr, height_flat, eval_match ? "yes" : "NO",
+               height_ptr == height_flat && eval_match ? "yes" : "NO");
+        free(vars);
+        freeFlatTree(flat);
+        freeTree(tree);
+    }
+}
+
+// Append a chain of count operands joined by op. Fully parenthesized
+// left-deep binary when nested is set, otherwise one flat chain.
+int append_chain(char *formula, int pos, int count, char op, bool nested, int seed, bool clauses, int width) {
+    for (int i = 0; i < (nested ? count - 1 : 1); i++) formula[pos++] = '(';
+    for (int i = 0; i < count; i++) {
+        if (i > 0) formula[pos++] = op;
+        if (clauses)
+            pos = append_chain(formula, pos, width, '+', nested, seed + i, false, 0);
+        else
+            formula[pos++] = 'a' + (seed * 7 + i) % 26;
+        if (nested && i > 0) formula[pos++] = ')';
+    }
+    if (!nested) formula[pos++] = ')';
+    return pos;
+}
+
+// Test n-ary AND/OR nodes: wide clauses as binary chains versus one node
+void test_nary(int max_width) {
+    int num_clauses = 64;
+    printf("Testing N-ary Nodes (%d clauses of width w, binary chains vs n-ary)\n", num_clauses);
+    printf("w,layout,nodes,height,parse_sec,eval_sec,cnf_sec,dimacs_sec,flatten_sec\n");
+    for (int width = 16; width <= max_width; width *= 4) {
+        char *formula = malloc((size_t)num_clauses * width * 4 + num_clauses * 4 + 4);
+        for (int nested = 1; nested >= 0; nested--) {
+            int len = append_chain(formula, 0, num_clauses, '*', nested, 0, true, width);
+            formula[len] = '\0';
+
+            double t0 = get_wall_time();
+            Node *tree = buildParseTree(formula);
+            double t1 = get_wall_time();
+
+            int nodes = countNodes(tree);
+            int height = calculateHeight(tree);
+            int varCount = 0;
+            int *vars = collectVariables(tree, &varCount);
+            TruthAssignment assignments[26];
+            for (int i = 0; i < varCount; i++) {
+                assignments[i].variable = vars[i];
+                assignments[i].value = 0;
+            }
+
+            double t2 = get_wall_time();
+            evaluateFormula(tree, assignments, varCount);
+            double t3 = get_wall_time();
+            Node *cnf = convertToCNF(cloneTree(tree));
+            double t4 = get_wall_time();
+            DIMACSFormula *dimacs = treeToDIMACS(cnf);
+            double t5 = get_wall_time();
+            cnf = flattenAssociative(cnf);
+            double t6 = get_wall_time();
+
+            printf("%d,%s,%d,%d,%.6f,%.6f,%.6f,%.6f,%.6f\n", width, nested ? "binary" : "nary", nodes, height,
+                   t1 - t0, t3 - t2, t4 - t3, t5 - t4, t6 - t5);
+            freeDIMACS(dimacs);
+            freeTree(cnf);
+            freeTree(tree);
+            free(vars);
+        }
+        fflush(stdout);
+        free(formula);
+    }
+
+    printf("\nDistribution of an OR of k ANDs (binary chain vs n-ary product)\n");
+    printf("k,binary_sec,binary_nodes,nary_sec,nary_nodes\n");
+    for (int k = 2; k <= 13; k++) {
+        char formula[200];
+        double times[2];
+        int nodes[2];
+        for (int nested = 1; nested >= 0; nested--) {
+            generate_or_of_ands(formula, k, nested);
+            Node *tree = buildParseTree(formula);
+            double start = get_wall_time();
+            Node *cnf = convertToCNF(tree);
+            times[nested] = get_wall_time() - start;
+            nodes[nested] = countNodes(cnf);
+            freeTree(cnf);
+        }
+        printf("%d,%.6f,%d,%.6f,%d\n", k, times[1], nodes[1], times[0], nodes[0]);
+    }
+}
+
+// Test the symbol table: one wide clause over n distinct named variables.
+// Interning and DIMACS numbering are O(1) per literal, so the time per
+// literal should stay flat as n grows.
+void test_symbols(int max_n) {
+    printf("Testing Symbol Table (one clause of n named variables)\n");
+    printf("n,parse_sec,collect_sec,dimacs_sec,ns_per_literal,symbols\n");
+    for (int n = 1000; n <= max_n; n *= 10) {
+        char *formula = malloc((size_t)n * 16 + 4);
+        int pos = 0;
+        formula[pos++] = '(';
+        for (int i = 0; i < n; i++) {
+            if (i > 0) formula[pos++] = '+';
+            pos += sprintf(formula + pos, "%sx_%d", i % 3 == 0 ? "~" : "", i);
+        }
+        formula[pos++] = ')';
+        formula[pos] = '\0';
+
+        // Negations swallow the rest of the group, so wrap them
+        char *wrapped = malloc((size_t)pos * 2 + 4);
+        int out = 0;
+        for (int i = 0; formula[i] != '\0'; i++) {
+            if (formula[i] == '~') {
+                wrapped[out++] = '(';
+                wrapped[out++] = '~';
+                while (formula[i + 1] != '+' && formula[i + 1] != ')') wrapped[out++] = formula[++i];
+                wrapped[out++] = ')';
+            } else {
+                wrapped[out++] = formula[i];
+            }
+        }
+        wrapped[out] = '\0';
+
+        double t0 = get_wall_time();
+        Node *tree = buildParseTree(wrapped);
+        double t1 = get_wall_time();
+        int varCount = 0;
+        int *vars = collectVariables(tree, &varCount);
+        double t2 = get_wall_time();
+        DIMACSFormula *dimacs = treeToDIMACS(tree);
+        double t3 = get_wall_time();
+
+        printf("%d,%.6f,%.6f,%.6f,%.1f,%d\n", n, t1 - t0, t2 - t1, t3 - t2,
+               (t3 - t0) * 1e9 / n, varCount);
+        fflush(stdout);
+        freeDIMACS(dimacs);
+        free(vars);
+        freeTree(tree);
+        free(wrapped);
+        free(formula);
+    }
+}
+
+// Test evaluation (single assignment)
+void test_evaluation(int max_n) {
+    printf("Testing Evaluation Time\n");
+    printf("n,time_sec\n");
+    for (int n = 10; n <= max_n; n += 10) {
+        char formula[2000];
+        generate_formula(formula, n);
+
+        Node *tree = buildParseTree(formula);
+        int varCount = 0;
+        int *vars = collectVariables(tree, &varCount);
+
+        TruthAssignment assignments[26];
+        for (int i = 0; i < varCount; i++) {
+            assignments[i].variable = vars[i];
+            assignments[i].value = 1; // fixed
+        }
+
+        clock_t start = clock();
+        int result = evaluateFormula(tree, assignments, varCount);
+        clock_t end = clock();
+
+        double time_taken = (double)(end - start) / CLOCKS_PER_SEC;
+
+        printf("%d,%.6f\n", n, time_taken);
+        freeTree(tree);
+        free(vars);
+    }
+}
+
+// Test truth table (exponential), 64 rows per pass on every core. Sampled
+// rows are checked against evaluateFormula outside the timed region.
+void test_truth_table(int max_k) {
+    printf("Testing Truth Table Time\n");
+    printf("k,time_sec,true_rows,match\n");
+    for (int k = 1; k <= max_k; k++) {
+        // Generate formula with k variables
+        char formula[200];
+        strcpy(formula, "(");
+        for (int i = 0; i < k; i++) {
+            char var = 'a' + i;
+            if (i > 0) strcat(formula, "+");
+            strncat(formula, &var, 1);
+        }
+        strcat(formula, ")");
+
+        Node *tree = buildParseTree(formula);
+
+        // Wall time: clock() would add up the CPU time of every worker
+        double start = get_wall_time();
+        Program *program = compileFormula(tree);
+        TruthTableSummary summary;
+        uint64_t *table = enumerateTruthTable(program, availableCores(), NULL, NULL, &summary);
+        double time_taken = get_wall_time() - start;
+
+        int total = 1 << k;
+        long long true_rows = summary.satisfying;
+        bool match = true;
+        int stride = total > 4096 ? total / 4096 + 1 : 1;
+        for (int a = 0; a < total && match; a += stride) {
+            TruthAssignment assignments[26];
+            for (int i = 0; i < k; i++) {
+                assignments[i].variable = program->slotVars[i];
+                assignments[i].value = (a >> i) & 1;
+            }
+            match = evaluateFormula(tree, assignments, k) == (int)((table[a >> 6] >> (a & 63)) & 1);
+        }
+
+        printf("%d,%.6f,%lld,%s\n", k, time_taken, true_rows, match ? "yes" : "NO");
+        free(table);
+        freeProgram(program);
+        freeTree(tree);
+    }
+}
+
+// Test the bytecode evaluator against the tree walker on CNF-shaped
+// formulas of c clauses (width 8), over the same pseudo-random rows. The
+// 64-lane column packs 64 rows into each variable word per pass.
+void test_bytecode(int max_clauses) {
+    int rows = 1 << 16;
+    printf("Testing Bytecode Evaluation (%d rows per formula)\n", rows);
+    printf("clauses,layout,nodes,code_len,max_stack,tree_evals_per_sec,bytecode_evals_per_sec,lanes64_evals_per_sec,speedup,match\n");
+    for (int clauses = 4; clauses <= max_clauses; clauses *= 4) {
+        char *formula = malloc((size_t)clauses * 8 * 4 + clauses * 4 + 4);
+        for (int nested = 1; nested >= 0; nested--) {
+            int len = append_chain(formula, 0, clauses, '*', nested, 0, true, 8);
+            formula[len] = '\0';
+            Node *tree = buildParseTree(formula);
+            Program *program = compileFormula(tree);
+            int varCount = program->numSlots;
+
+            unsigned int *masks = malloc(rows * sizeof(unsigned int));
+            unsigned int seed = 12345;
+            for (int r = 0; r < rows; r++) {
+                seed = seed * 1103515245u + 12345u;
+                masks[r] = seed >> 6;
+            }
+
+            TruthAssignment assignments[26];
+            unsigned char values[26];
+            int tree_true = 0, code_true = 0;
+            double t0 = get_wall_time();
+            for (int r = 0; r < rows; r++) {
+                for (int i = 0; i < varCount; i++) {
+                    assignments[i].variable = program->slotVars[i];
+                    assignments[i].value = (masks[r] >> i) & 1;
+                }
+                tree_true += evaluateFormula(tree, assignments, varCount);
+            }
+            double t1 = get_wall_time();
+            for (int r = 0; r < rows; r++) {
+                for (int i = 0; i < varCount; i++) values[i] = (masks[r] >> i) & 1;
+                code_true += evaluateProgram(program, values);
+            }
+            double t2 = get_wall_time();
+            uint64_t words[26];
+            int lane_true = 0;
+            for (int r = 0; r < rows; r += 64) {
+                for (int i = 0; i < varCount; i++) {
+                    uint64_t w = 0;
+                    for (int j = 0; j < 64; j++) w |= (uint64_t)((masks[r + j] >> i) & 1) << j;
+                    words[i] = w;
+                }
+                lane_true += __builtin_popcountll(evaluateProgramWords(program, words));
+            }
+            double t3 = get_wall_time();
+
+            // Row by row agreement, outside the timed loops
+            bool match = tree_true == code_true && tree_true == lane_true;
+            for (int r = 0; r < rows && match; r += 97) {
+                for (int i = 0; i < varCount; i++) {
+                    assignments[i].variable = program->slotVars[i];
+                    assignments[i].value = values[i] = (masks[r] >> i) & 1;
+                }
+                match = evaluateFormula(tree, assignments, varCount) == evaluateProgram(program, values);
+            }
+
+            printf("%d,%s,%d,%d,%d,%.0f,%.0f,%.0f,%.2f,%s\n", clauses, nested ? "binary" : "nary", countNodes(tree),
+                   program->length, program->maxStack, rows / (t1 - t0), rows / (t2 - t1), rows / (t3 - t2),
+                   (t1 - t0) / (t2 - t1), match ? "yes" : "NO");
+            fflush(stdout);
+            free(masks);
+            freeProgram(program);
+            freeTree(tree);
+        }
+        free(formula);
+    }
+}
+
+// Test the truth-table kernels per instruction set on a CNF-shaped formula
+// over k variables. Every level must produce the scalar table bit for bit.
+void test_simd(int max_k) {
+    int best = detectSimdLevel();
+    printf("Testing SIMD Truth Tables (best level: %s)\n", simdLevelName(best));
+    printf("k,isa,lanes,time_sec,assignments_per_sec,match\n");
+    for (int k = 16; k <= max_k; k += 2) {
+        // (a+~b+c)*(~c+d+~e)*... over k letters, with an implication per clause
+        char formula[1024];
+        int pos = 0;
+        formula[pos++] = '(';
+        for (int i = 0; i < k; i++) {
+            if (i > 0) formula[pos++] = '*';
+            pos += sprintf(formula + pos, "((%c+(~%c))>(%c+%c))", 'a' + i, 'a' + (i + 1) % k,
+                           'a' + (i + 2) % k, 'a' + (i * 5 + 3) % k);
+        }
+        formula[pos++] = ')';
+        formula[pos] = '\0';
+
+        Node *tree = buildParseTree(formula);
+        Program *program = compileFormula(tree);
+        long long words = ((1LL << program->numSlots) + 63) / 64;
+        uint64_t *reference = NULL;
+        for (int level = 0; level <= best; level++) {
+            double t0 = get_wall_time();
+            uint64_t *table = computeTruthTableSimd(program, level);
+            double elapsed = get_wall_time() - t0;
+            bool match = true;
+            if (reference == NULL) reference = table;
+            else match = memcmp(reference, table, words * sizeof(uint64_t)) == 0;
+            printf("%d,%s,%d,%.6f,%.0f,%s\n", k, simdLevelName(level), 64 << level, elapsed,
+                   (double)(1LL << program->numSlots) / elapsed, match ? "yes" : "NO");
+            fflush(stdout);
+            if (table != reference) free(table);
+        }
+        free(reference);
+        freeProgram(program);
+        freeTree(tree);
+    }
+}
+
+// Strong scaling of the parallel truth table: one 2^k table on 1..N
+// threads. Every run must give the single-thread table and summary.
+void test_parallel_truth_table(int k, int max_threads) {
+    char formula[1024];
+    int pos = 0;
+    formula[pos++] = '(';
+    for (int i = 0; i < k; i++) {
+        if (i > 0) formula[pos++] = '*';
+        pos += sprintf(formula + pos, "((%c+(~%c))>(%c+%c))", 'a' + i, 'a' + (i + 1) % k,
+                       'a' + (i + 2) % k, 'a' + (i * 5 + 3) % k);
+    }
+    formula[pos++] = ')';
+    formula[pos] = '\0';
+
+    Node *tree = buildParseTree(formula);
+    Program *program = compileFormula(tree);
+    long long words = ((1LL << program->numSlots) + 63) / 64;
+    printf("Testing Parallel Truth Table (k=%d, %d cores)\n", program->numSlots, availableCores());
+    printf("threads,time_sec,speedup,efficiency,satisfying,first_model,last_model,match\n");
+
+    uint64_t *reference = NULL;
+    TruthTableSummary base;
+    double base_time = 0;
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        TruthTableSummary summary;
+        double t0 = get_wall_time();
+        uint64_t *table = enumerateTruthTable(program, threads, NULL, NULL, &summary);
+        double elapsed = get_wall_time() - t0;
+        bool match = true;
+        if (reference == NULL) {
+            reference = table;
+            base = summary;
+            base_time = elapsed;
+        } else {
+            match = memcmp(reference, table, words * sizeof(uint64_t)) == 0 &&
+                    summary.satisfying == base.satisfying && summary.firstModel == base.firstModel &&
+                    summary.lastModel == base.lastModel;
+        }
+        printf("%d,%.6f,%.2f,%.2f,%lld,%lld,%lld,%s\n", threads, elapsed, base_time / elapsed,
+               base_time / elapsed / threads, summary.satisfying, summary.firstModel, summary.lastModel,
+               match ? "yes" : "NO");
+        fflush(stdout);
+        if (table != reference) free(table);
+    }
+    free(reference);
+    freeProgram(program);
+    freeTree(tree);
+}
+
+// Test Gray-code incremental evaluation: c random 3-literal clauses over
+// k variables. Full re-evaluation costs the whole tree per row, while the
+// incremental walk should track the flipped variable's occurrences.
+void test_gray_code(int k, int max_clauses) {
+    int rows = 1 << k;
+    printf("Testing Gray-Code Truth Tables (k=%d, %d rows)\n", k, rows);
+    printf("clauses,nodes,occurrences_per_var,bytecode_sec,bytecode_ns_per_row,gray_sec,gray_ns_per_row,updates_per_row,speedup,match\n");
+    for (int clauses = 64; clauses <= max_clauses; clauses *= 4) {
+        char *formula = malloc((size_t)clauses * 48 + 4);
+        int pos = 0;
+        unsigned int seed = 2024;
+        formula[pos++] = '(';
+        for (int c = 0; c < clauses; c++) {
+            if (c > 0) formula[pos++] = '*';
+            formula[pos++] = '(';
+            for (int l = 0; l < 3; l++) {
+                seed = seed * 1103515245u + 12345u;
+                int var = (seed >> 8) % k;
+                if (l > 0) formula[pos++] = '+';
+                pos += sprintf(formula + pos, (seed >> 4) & 1 ? "(~v%d)" : "v%d", var);
+            }
+            formula[pos++] = ')';
+        }
+        formula[pos++] = ')';
+        formula[pos] = '\0';
+
+        Node *tree = buildParseTree(formula);
+        Program *program = compileFormula(tree);
+        unsigned char values[32];
+        double t0 = get_wall_time();
+        for (int r = 0; r < rows; r++) {
+            for (int i = 0; i < k; i++) values[i] = (r >> i) & 1;
+            evaluateProgram(program, values);
+        }
+        double bytecode_time = get_wall_time() - t0;
+
+        t0 = get_wall_time();
+        IncrementalCircuit *circuit = buildIncrementalCircuit(tree);
+        uint64_t *table = grayCodeTruthTable(circuit, NULL, NULL);
+        double gray_time = get_wall_time() - t0;
+
+        uint64_t *reference = computeTruthTable(program);
+        bool match = memcmp(reference, table, ((rows + 63) / 64) * sizeof(uint64_t)) == 0;
+
+        printf("%d,%d,%.1f,%.6f,%.1f,%.6f,%.1f,%.2f,%.2f,%s\n", clauses, circuit->numNodes, clauses * 3.0 / k,
+               bytecode_time, bytecode_time * 1e9 / rows, gray_time, gray_time * 1e9 / rows,
+               (double)circuit->updates / rows, bytecode_time / gray_time, match ? "yes" : "NO");
+        fflush(stdout);
+        free(reference);
+        free(table);
+        freeIncrementalCircuit(circuit);
+        freeProgram(program);
+        freeTree(tree);
+        free(formula);
+    }
+}
+
+// Test cofactor splitting against the brute-force row loop and the SIMD
+// kernels, on the truth-table workload (an OR of k variables), on the CNF
+// of the SIMD test, and on that CNF guarded by two more variables
+void test_cofactor(int max_k) {
+    const char *workloads[3] = {"or_chain", "cnf", "guarded"};
+    printf("Testing Cofactor Truth Tables\n");
+    printf("k,workload,brute_sec,simd_sec,cofactor_sec,constant_blocks,constant_rows_pct,speedup_vs_simd,match\n");
+    for (int k = 14; k <= max_k; k += 4) {
+        for (int w = 0; w < 3; w++) {
+            // The guarded CNF uses k - 2 letters; its guard variables come
+            // last, so they are the first ones the splitter fixes
+            int letters = w == 2 ? k - 2 : k;
+            char formula[2048];
+            int pos = 0;
+            formula[pos++] = '(';
+            for (int i = 0; i < letters; i++) {
+                if (w == 0) {
+                    if (i > 0) formula[pos++] = '+';
+                    formula[pos++] = 'a' + i;
+                } else {
+                    if (i > 0) formula[pos++] = '*';
+                    pos += sprintf(formula + pos, "((%c+(~%c))>(%c+%c))", 'a' + i, 'a' + (i + 1) % letters,
+                                   'a' + (i + 2) % letters, 'a' + (i * 5 + 3) % letters);
+                }
+            }
+            if (w == 2) pos += sprintf(formula + pos, "*(g1*g2)");
+            formula[pos++] = ')';
+            formula[pos] = '\0';
+
+            Node *tree = buildParseTree(formula);
+            Program *program = compileFormula(tree);
+            int rows = 1 << program->numSlots;
+
+            // Brute force: one bytecode run per row, skipped above 2^22 rows
+            double brute_time = -1;
+            unsigned char values[32];
+            if (program->numSlots <= 22) {
+                double t0 = get_wall_time();
+                for (int r = 0; r < rows; r++) {
+                    for (int i = 0; i < program->numSlots; i++) values[i] = (r >> i) & 1;
+                    evaluateProgram(program, values);
+                }
+                brute_time = get_wall_time() - t0;
+            }
+
+            double t0 = get_wall_time();
+            uint64_t *reference = computeTruthTable(program);
+            double simd_time = get_wall_time() - t0;
+            CofactorStats stats;
+            t0 = get_wall_time();
+            uint64_t *table = cofactorTruthTable(program, &stats);
+            double cofactor_time = get_wall_time() - t0;
+            bool match = memcmp(reference, table, ((rows + 63) / 64) * sizeof(uint64_t)) == 0;
+
+            printf("%d,%s,%.6f,%.6f,%.6f,%lld,%.1f,%.2f,%s\n", program->numSlots, workloads[w], brute_time,
+                   simd_time, cofactor_time, stats.constantBlocks, 100.0 * stats.constantRows / rows,
+                   simd_time / cofactor_time, match ? "yes" : "NO");
+            fflush(stdout);
+            free(reference);
+            free(table);
+            freeProgram(program);
+            freeTree(tree);
+        }
+    }
+}
+
+// Test truth-table output: per-cell fprintf to a screen stand-in and a
+// file (two passes, as option 17 used to) versus one buffered pass to both,
+// then the binary format's size and random row lookups through mmap
+void test_table_output(int max_k) {
+    const char *text_path = "/tmp/test_complexity_table.txt";
+    const char *binary_path = "/tmp/test_complexity_table.ttb";
+    printf("Testing Truth Table Output (screen stand-in: /dev/null, file: %s)\n", text_path);
+    printf("k,text_bytes,fprintf_sec,fprintf_MBps,writer_sec,writer_MBps,binary_bytes,binary_save_sec,lookups_per_sec,true_lookups,match\n");
+    for (int k = 12; k <= max_k; k += 4) {
+        char formula[200];
+        int pos = 0;
+        formula[pos++] = '(';
+        for (int i = 0; i < k; i++) {
+            if (i > 0) formula[pos++] = '*';
+            pos += sprintf(formula + pos, "(%c+(~%c))", 'a' + i, 'a' + (i + 1) % k);
+        }
+        formula[pos++] = ')';
+        formula[pos] = '\0';
+
+        Node *tree = buildParseTree(formula);
+        Program *program = compileFormula(tree);
+        uint64_t *table = computeTruthTable(program);
+        int rows = 1 << k;
+        FILE *screen = fopen("/dev/null", "w");
+
+        double t0 = get_wall_time();
+        for (int pass = 0; pass < 2; pass++) {
+            FILE *out = pass == 0 ? screen : fopen(text_path, "w");
+            for (int r = 0; r < rows; r++) {
+                for (int i = 0; i < k; i++) fprintf(out, "%d ", (r >> i) & 1);
+                fprintf(out, "%s\n", (table[r >> 6] >> (r & 63)) & 1 ? "T" : "F");
+            }
+            if (pass == 1) fclose(out);
+        }
+        double fprintf_time = get_wall_time() - t0;
+
+        t0 = get_wall_time();
+        FILE *file = fopen(text_path, "w");
+        TableWriter *writer = createTableWriter(k);
+        addTableSink(writer, screen);
+        addTableSink(writer, file);
+        writeTableHeader(writer, tree, program->slotVars, k);
+        TruthTableSummary summary;
+        uint64_t *streamed = enumerateTruthTable(program, 1, writeTableRow, writer, &summary);
+        destroyTableWriter(writer);
+        fclose(file);
+        double writer_time = get_wall_time() - t0;
+        fclose(screen);
+        double text_bytes = (double)rows * (2 * k + 2);
+
+        t0 = get_wall_time();
+        saveTruthTableBinary(binary_path, table, program->slotVars, k);
+        double save_time = get_wall_time() - t0;
+
+        TruthTableFile *mapped = openTruthTableFile(binary_path);
+        bool match = mapped != NULL && memcmp(table, streamed, ((rows + 63) / 64) * sizeof(uint64_t)) == 0;
+        int lookups = 1 << 22;
+        unsigned int seed = 7;
+        long long hits = 0;
+        t0 = get_wall_time();
+        for (int i = 0; i < lookups && mapped != NULL; i++) {
+            seed = seed * 1103515245u + 12345u;
+            hits += truthTableFileRow(mapped, seed % rows);
+        }
+        double lookup_time = get_wall_time() - t0;
+        for (int r = 0; r < rows && match; r += 1 + r / 64)
+            match = truthTableFileRow(mapped, r) == (int)((table[r >> 6] >> (r & 63)) & 1);
+
+        printf("%d,%.0f,%.6f,%.1f,%.6f,%.1f,%zu,%.6f,%.0f,%lld,%s\n", k, text_bytes, fprintf_time,
+               2 * text_bytes / fprintf_time / 1e6, writer_time, 2 * text_bytes / writer_time / 1e6,
+               mapped != NULL ? mapped->view.size : 0, save_time, lookups / lookup_time, hits, match ? "yes" : "NO");
+        fflush(stdout);
+        closeTruthTableFile(mapped);
+        free(streamed);
+        free(table);
+        freeProgram(program);
+        freeTree(tree);
+    }
+
+    // Headers whose row bits would overlap the header, or are misaligned,
+    // must be rejected, not mapped
+    const char *bad_path = "/tmp/test_complexity_bad.ttb";
+    FILE *saved = fopen(binary_path, "rb");
+    fseek(saved, 0, SEEK_END);
+    long saved_size = ftell(saved);
+    fseek(saved, 0, SEEK_SET);
+    char *bytes = malloc(saved_size);
+    size_t got = fread(bytes, 1, saved_size, saved);
+    fclose(saved);
+    uint64_t bad_offsets[3] = {0, 8, sizeof(TruthTableFileHeader) + 1};
+    for (int i = 0; i < 3 && got == (size_t)saved_size; i++) {
+        TruthTableFileHeader header;
+        memcpy(&header, bytes, sizeof(header));
+        header.dataOffset = littleEndian64(bad_offsets[i]);
+        FILE *bad = fopen(bad_path, "wb");
+        fwrite(&header, sizeof(header), 1, bad);
+        fwrite(bytes + sizeof(header), 1, saved_size - sizeof(header), bad);
+        fclose(bad);
+        TruthTableFile *opened = openTruthTableFile(bad_path);
+        printf("malformed_offset,%llu,%s\n", (unsigned long long)bad_offsets[i], opened == NULL ? "rejected" : "NO");
+        closeTruthTableFile(opened);
+    }
+    free(bytes);
+    remove(bad_path);
+    remove(text_path);
+    remove(binary_path);
+}
+
+// Count the clauses and literals of a CNF tree: the operands of its
+// top-level AND chain, and the variable leaves below them
+void count_cnf_clauses(Node *root, long *clauses, long *literals) {
+    *clauses = 0;
+    *literals = 0;
+    if (!root) return;
+    int capacity = 1024, top = 0;
+    Node **stack = malloc(capacity * sizeof(Node *));
+    bool *inClause = malloc(capacity * sizeof(bool));
+    stack[top] = root;
+    inClause[top++] = false;
+    while (top > 0) {
+        Node *node = stack[--top];
+        bool clause = inClause[top];
+        if (!clause && node->value != '*') {
+            (*clauses)++;
+            clause = true;
+        }
+        if (!isOperator(node->value)) {
+            (*literals)++;
+            continue;
+        }
+        if (top + node->numChildren + 2 > capacity) {
+            capacity = (top + node->numChildren + 2) * 2;
+            stack = realloc(stack, capacity * sizeof(Node *));
+            inClause = realloc(inClause, capacity * sizeof(bool));
+        }
+        for (int i = 0; i < node->numChildren; i++) {
+            stack[top] = node->children[i];
+            inClause[top++] = clause;
+        }
+        if (node->left) {
+            stack[top] = node->left;
+            inClause[top++] = clause;
+        }
+        if (node->right) {
+            stack[top] = node->right;
+            inClause[top++] = clause;
         }
     }
+    free(inClause);
+    free(stack);
+}
 
-    return true; // All clauses satisfied
+// Generate an OR of k two-variable ANDs with numbered names:
+// ((x1*y1)+(x2*y2)+...), so k is not limited by the alphabet
+void generate_named_or_of_ands(char *formula, int k) {
+    int pos = 0;
+    formula[pos++] = '(';
+    for (int i = 1; i <= k; i++) {
+        if (i > 1) formula[pos++] = '+';
+        pos += sprintf(formula + pos, "(x%d*y%d)", i, i);
+    }
+    formula[pos++] = ')';
+    formula[pos] = '\0';
 }
 
-// Print variable mapping
-void printVarMapping()
-{
-    printf("\nVariable Mapping:\n");
-    printf("Char -> Integer\n");
-    for (int i = 0; i < varMapSize; i++)
-    {
-        printf("  %c   ->   %d\n", varMap[i].charVar, varMap[i].intVar);
+// Check a gate encoding of tree by brute force when it has at most 20
+// variables: the formula holds for an assignment of the original
+// variables exactly when some assignment of the auxiliaries satisfies
+// the clauses. Returns "yes", "NO", or "-" when too large to check.
+const char *check_equisatisfiable(Node *tree, DIMACSFormula *dimacs) {
+    if (dimacs->numVars > 20) return "-";
+    // Original variables are numbered first, in collectVariables order
+    int varCount = 0;
+    int *vars = collectVariables(tree, &varCount);
+    int *assignment = calloc(dimacs->numVars + 1, sizeof(int));
+    TruthAssignment values[20];
+    bool ok = true;
+    for (int row = 0; row < (1 << varCount) && ok; row++) {
+        for (int i = 0; i < varCount; i++) {
+            values[i].variable = vars[i];
+            values[i].value = assignment[i + 1] = (row >> i) & 1;
+        }
+        bool extends = false;
+        int aux = dimacs->numVars - varCount;
+        for (int a = 0; a < (1 << aux) && !extends; a++) {
+            for (int i = 0; i < aux; i++) assignment[varCount + 1 + i] = (a >> i) & 1;
+            extends = evaluateDIMACS(dimacs, assignment);
+        }
+        ok = extends == (evaluateFormula(tree, values, varCount) == 1);
     }
+    free(assignment);
+    free(vars);
+    return ok ? "yes" : "NO";
 }
 
-// Free DIMACS formula
-void freeDIMACS(DIMACSFormula *formula)
-{
-    if (formula == NULL)
-        return;
+// Test Tseitin encoding against distribution on an OR of k ANDs.
+// Distribution gives 2^k clauses, Tseitin 4k + 2.
+void test_tseitin(int max_k, int max_distribute_k) {
+    printf("Testing Tseitin Encoding (OR of k ANDs)\n");
+    printf("k,dist_sec,dist_clauses,dist_literals,tseitin_sec,tseitin_vars,tseitin_clauses,tseitin_literals,equisat\n");
+    for (int k = 2; k <= max_k; k += (k < 16 ? 2 : k)) {
+        char *formula = malloc((size_t)k * 24 + 4);
+        generate_named_or_of_ands(formula, k);
+        Node *tree = buildParseTree(formula);
 
-    for (int i = 0; i < formula->numClauses; i++)
-    {
-        free(formula->clauses[i].literals);
+        double dist_time = -1;
+        long dist_clauses = -1, dist_literals = -1;
+        if (k <= max_distribute_k) {
+            double t0 = get_wall_time();
+            Node *cnf = convertToCNF(cloneTree(tree));
+            dist_time = get_wall_time() - t0;
+            count_cnf_clauses(cnf, &dist_clauses, &dist_literals);
+            freeTree(cnf);
+        }
+
+        double t0 = get_wall_time();
+        DIMACSFormula *dimacs = convertToDIMACS(tree, CNF_TSEITIN, CNF_DEFAULT_BUDGET);
+        double tseitin_time = get_wall_time() - t0;
+        long literals = 0;
+        for (int i = 0; i < dimacs->numClauses; i++) literals += dimacs->clauses[i].size;
+
+        const char *equisat = check_equisatisfiable(tree, dimacs);
+
+        printf("%d,%.6f,%ld,%ld,%.6f,%d,%d,%ld,%s\n", k, dist_time, dist_clauses, dist_literals, tseitin_time,
+               dimacs->numVars, dimacs->numClauses, literals, equisat);
+        fflush(stdout);
+        freeDIMACS(dimacs);
+        freeTree(tree);
+        free(formula);
     }
-    free(formula->clauses);
-    free(formula);
 }
 
-// Free the tree
-void freeTree(Node *root)
-{
-    if (root == NULL)
+// Generate a formula from one of the Plaisted-Greenbaum corpora, with k
+// terms and numbered names:
+//   or_of_ands  ((x1*y1)+(x2*y2)+...)
+//   implies     ((x1*(~y1))>(y1+z1))*... guarded implications, so the
+//               left side of each '>' appears negatively
+//   clause_set  (x1+(~y1)+z1)*... an n-ary AND of n-ary ORs
+//   nested      (x1+(~(x2*(~(x3+...))))) alternating polarity with depth
+void generate_pg_corpus(char *formula, const char *shape, int k) {
+    int pos = 0;
+    if (strcmp(shape, "or_of_ands") == 0) {
+        generate_named_or_of_ands(formula, k);
         return;
+    }
+    if (strcmp(shape, "nested") == 0) {
+        for (int i = 1; i < k; i++) {
+            pos += sprintf(formula + pos, "(x%d%c(~", i, i % 2 ? '+' : '*');
+        }
+        pos += sprintf(formula + pos, "x%d", k);
+        for (int i = 1; i < k; i++) pos += sprintf(formula + pos, "))");
+        formula[pos] = '\0';
+        return;
+    }
+    formula[pos++] = '(';
+    for (int i = 1; i <= k; i++) {
+        if (i > 1) formula[pos++] = '*';
+        if (strcmp(shape, "implies") == 0) {
+            pos += sprintf(formula + pos, "((x%d*(~y%d))>(y%d+z%d))", i, i, i, i);
+        } else {
+            pos += sprintf(formula + pos, "(x%d+(~y%d)+z%d)", i, i, i);
+        }
+    }
+    formula[pos++] = ')';
+    formula[pos] = '\0';
+}
+
+// Test the Plaisted-Greenbaum encoding against full Tseitin on each
+// corpus: clause and literal savings, encoding time, and equisatisfiability
+// by brute force on the small instances.
+void test_plaisted_greenbaum(int max_k) {
+    const char *shapes[4] = {"or_of_ands", "implies", "clause_set", "nested"};
+    printf("Testing Plaisted-Greenbaum Encoding vs Tseitin\n");
+    printf("shape,k,tseitin_sec,tseitin_clauses,tseitin_literals,pg_sec,pg_clauses,pg_literals,"
+           "clause_saving_pct,literal_saving_pct,equisat\n");
+    for (int s = 0; s < 4; s++) {
+        for (int k = 2; k <= max_k; k = k < 4 ? k + 1 : k * 4) {
+            char *formula = malloc((size_t)k * 40 + 4);
+            generate_pg_corpus(formula, shapes[s], k);
+            Node *tree = buildParseTree(formula);
+            if (!tree) {
+                printf("%s,%d,parse failed\n", shapes[s], k);
+                free(formula);
+                continue;
+            }
 
-    freeTree(root->left);
-    freeTree(root->right);
-    free(root);
+            DIMACSFormula *encodings[2];
+            double times[2];
+            long clauses[2], literals[2];
+            for (int mode = 0; mode < 2; mode++) {
+                double t0 = get_wall_time();
+                encodings[mode] =
+                    convertToDIMACS(tree, mode == 0 ? CNF_TSEITIN : CNF_PLAISTED_GREENBAUM, CNF_DEFAULT_BUDGET);
+                times[mode] = get_wall_time() - t0;
+                clauses[mode] = encodings[mode]->numClauses;
+                literals[mode] = 0;
+                for (int i = 0; i < encodings[mode]->numClauses; i++) literals[mode] += encodings[mode]->clauses[i].size;
+            }
+
+            const char *equisat = check_equisatisfiable(tree, encodings[1]);
+            printf("%s,%d,%.6f,%ld,%ld,%.6f,%ld,%ld,%.1f,%.1f,%s\n", shapes[s], k, times[0], clauses[0], literals[0],
+                   times[1], clauses[1], literals[1], 100.0 * (clauses[0] - clauses[1]) / clauses[0],
+                   100.0 * (literals[0] - literals[1]) / literals[0], equisat);
+            fflush(stdout);
+            freeDIMACS(encodings[0]);
+            freeDIMACS(encodings[1]);
+            freeTree(tree);
+            free(formula);
+        }
+    }
 }
 
-// Collect unique variables from the tree
-void collectVariables(Node *root, char *vars, int *count)
-{
-    if (root == NULL)
-        return;
-    if (!isOperator(root->value))
-    {
-        // Check if already present
-        for (int i = 0; i < *count; i++)
-        {
-            if (vars[i] == root->value)
-                return;
+// Generate an OR of k three-literal ANDs over the 8 variables a..h, with
+// pseudo-random (but fixed) choices, so distribution meets many repeated
+// literals, tautologies and subsumed clauses
+void generate_shared_or_of_ands(char *formula, int k) {
+    unsigned int seed = 12345;
+    int pos = 0;
+    formula[pos++] = '(';
+    for (int i = 0; i < k; i++) {
+        if (i > 0) formula[pos++] = '+';
+        formula[pos++] = '(';
+        for (int j = 0; j < 3; j++) {
+            seed = seed * 1103515245 + 12345;
+            int var = (seed >> 16) % 8;
+            bool negated = (seed >> 8) & 1;
+            if (j > 0) formula[pos++] = '*';
+            pos += sprintf(formula + pos, negated ? "(~%c)" : "%c", 'a' + var);
         }
-        vars[*count] = root->value;
-        (*count)++;
+        formula[pos++] = ')';
     }
-    collectVariables(root->left, vars, count);
-    collectVariables(root->right, vars, count);
+    formula[pos++] = ')';
+    formula[pos] = '\0';
 }
 
-// Count nodes in tree
-void count_nodes(Node *root, int *node_count) {
-    if (root) {
-        (*node_count)++;
-        count_nodes(root->left, node_count);
-        count_nodes(root->right, node_count);
+// Test the clause-set CNF engine against tree distribution: clause and
+// literal counts, time, what was dropped, and equivalence over every
+// assignment when there are at most 20 variables
+void test_clause_set(int max_k, int max_distribute_k) {
+    const char *shapes[2] = {"or_of_ands", "shared"};
+    printf("Testing Clause-Set CNF vs Tree Distribution\n");
+    printf("shape,k,dist_sec,dist_clauses,dist_literals,set_sec,set_clauses,set_literals,"
+           "tautologies,duplicates,subsumed,equivalent\n");
+    for (int s = 0; s < 2; s++) {
+        for (int k = 2; k <= max_k; k += 2) {
+            char *formula = malloc((size_t)k * 40 + 4);
+            if (s == 0) generate_named_or_of_ands(formula, k);
+            else generate_shared_or_of_ands(formula, k);
+            Node *tree = buildParseTree(formula);
+
+            double dist_time = -1;
+            long dist_clauses = -1, dist_literals = -1;
+            if (k <= max_distribute_k) {
+                double t0 = get_wall_time();
+                Node *cnf = convertToCNF(cloneTree(tree));
+                dist_time = get_wall_time() - t0;
+                count_cnf_clauses(cnf, &dist_clauses, &dist_literals);
+                freeTree(cnf);
+            }
+
+            ClauseSetStats stats;
+            double t0 = get_wall_time();
+            DIMACSFormula *dimacs = clauseSetToDIMACS(tree, &stats);
+            double set_time = get_wall_time() - t0;
+            long literals = 0;
+            for (int i = 0; i < dimacs->numClauses; i++) literals += dimacs->clauses[i].size;
+
+            const char *equivalent = "-";
+            if (dimacs->numVars <= 20) {
+                int varCount = 0;
+                int *vars = collectVariables(tree, &varCount);
+                int *assignment = calloc(varCount + 1, sizeof(int));
+                TruthAssignment values[20];
+                bool ok = true;
+                for (int row = 0; row < (1 << varCount) && ok; row++) {
+                    for (int i = 0; i < varCount; i++) {
+                        values[i].variable = vars[i];
+                        values[i].value = assignment[i + 1] = (row >> i) & 1;
+                    }
+                    ok = evaluateDIMACS(dimacs, assignment) == (evaluateFormula(tree, values, varCount) == 1);
+                }
+                equivalent = ok ? "yes" : "NO";
+                free(assignment);
+                free(vars);
+            }
+
+            printf("%s,%d,%.6f,%ld,%ld,%.6f,%d,%ld,%lld,%lld,%lld,%s\n", shapes[s], k, dist_time, dist_clauses,
+                   dist_literals, set_time, dimacs->numClauses, literals, stats.tautologies, stats.duplicates,
+                   stats.subsumed, equivalent);
+            fflush(stdout);
+            freeDIMACS(dimacs);
+            freeTree(tree);
+            free(formula);
+        }
     }
 }
 
-// For testing, add timing
-double get_time() {
-    return (double)clock() / CLOCKS_PER_SEC;
+// Test the CNF planner: its prediction for plain distribution against
+// convertToCNF, its planned size against the clauses plannedToDIMACS
+// writes, and how the budget trades clauses for auxiliary variables
+void test_cnf_planner(int max_k) {
+    const char *shapes[3] = {"or_of_ands", "implies", "nested"};
+    long long budgets[4] = {1, 64, 4096, LLONG_MAX};
+    printf("Testing CNF Planner (predicted vs actual sizes)\n");
+    printf("shape,k,budget,plan_sec,predicted_dist_clauses,dist_clauses,predicted_clauses,predicted_literals,"
+           "emit_sec,clauses,literals,aux_vars,match,equisat\n");
+    for (int s = 0; s < 3; s++) {
+        for (int k = 4; k <= max_k; k *= 4) {
+            char *formula = malloc((size_t)k * 40 + 4);
+            generate_pg_corpus(formula, shapes[s], k);
+            Node *tree = buildParseTree(formula);
+
+            // Only distribute for real when the prediction says it fits
+            CnfPlan *unbounded = planCNF(tree, LLONG_MAX);
+            long dist_clauses = -1, dist_literals = -1;
+            if (unbounded->distributeClauses <= 100000) {
+                Node *cnf = convertToCNF(cloneTree(tree));
+                count_cnf_clauses(cnf, &dist_clauses, &dist_literals);
+                freeTree(cnf);
+            }
+            freeCnfPlan(unbounded);
+
+            for (int b = 0; b < 4; b++) {
+                double t0 = get_wall_time();
+                CnfPlan *plan = planCNF(tree, budgets[b]);
+                double plan_time = get_wall_time() - t0;
+
+                double emit_time = -1;
+                long long clauses = -1, literals = -1;
+                int aux = plan->namedSubtrees;
+                const char *match = "-", *equisat = "-";
+                if (plan->totalClauses <= 1000000 && plan->totalLiterals <= 20000000) {
+                    // convertToDIMACS must honour the same budget
+                    DIMACSFormula *converted = convertToDIMACS(tree, CNF_PLANNED, budgets[b]);
+                    bool same_budget = converted->numClauses == plan->totalClauses;
+                    freeDIMACS(converted);
+
+                    t0 = get_wall_time();
+                    DIMACSFormula *dimacs = plannedToDIMACS(tree, plan);
+                    emit_time = get_wall_time() - t0;
+                    clauses = dimacs->numClauses;
+                    literals = 0;
+                    for (int i = 0; i < dimacs->numClauses; i++) literals += dimacs->clauses[i].size;
+                    bool dist_ok = dist_clauses < 0 ||
+                                   (dist_clauses == plan->distributeClauses && dist_literals == plan->distributeLiterals);
+                    match = dist_ok && same_budget && clauses == plan->totalClauses && literals == plan->totalLiterals
+                                ? "yes"
+                                : "NO";
+                    equisat = check_equisatisfiable(tree, dimacs);
+                    freeDIMACS(dimacs);
+                }
+
+                printf("%s,%d,%lld,%.6f,%lld,%ld,%lld,%lld,%.6f,%lld,%lld,%d,%s,%s\n", shapes[s], k, budgets[b],
+                       plan_time, plan->distributeClauses, dist_clauses, plan->totalClauses, plan->totalLiterals,
+                       emit_time, clauses, literals, aux, match, equisat);
+                fflush(stdout);
+                freeCnfPlan(plan);
+            }
+            freeTree(tree);
+            free(formula);
+        }
+    }
 }
 
-// Generate test formula of length n (simple chain)
-void generate_formula(char *formula, int n) {
+// Generate a wide conjunction of k conjuncts, each an OR of m two-variable
+// ANDs with its own variables: ((a1_1*b1_1)+...)*((a2_1*b2_1)+...)*...
+// Every conjunct distributes to 2^m clauses independently of the others.
+void generate_wide_conjunction(char *formula, int k, int m) {
     int pos = 0;
     formula[pos++] = '(';
-    for (int i = 0; i < n / 2; i++) {
-        formula[pos++] = 'p';
-        if (i < n / 2 - 1) formula[pos++] = '+';
+    for (int i = 1; i <= k; i++) {
+        if (i > 1) formula[pos++] = '*';
+        formula[pos++] = '(';
+        for (int j = 1; j <= m; j++) {
+            if (j > 1) formula[pos++] = '+';
+            pos += sprintf(formula + pos, "(a%d_%d*b%d_%d)", i, j, i, j);
+        }
+        formula[pos++] = ')';
     }
     formula[pos++] = ')';
     formula[pos] = '\0';
 }
 
-// Test parsing
-void test_parsing(int max_n) {
-    printf("Testing Parsing Time and Space\n");
-    printf("n,time_sec,nodes\n");
-    for (int n = 10; n <= max_n; n += 10) {
-        char formula[2000];
-        generate_formula(formula, n);
+// Do two formulas have the same clauses in the same order, whatever
+// their layouts?
+bool same_dimacs(DIMACSFormula *a, DIMACSFormula *b) {
+    if (a->numVars != b->numVars || a->numClauses != b->numClauses) return false;
+    for (int i = 0; i < a->numClauses; i++) {
+        int size = dimacsClauseSize(a, i);
+        if (size != dimacsClauseSize(b, i)) return false;
+        for (int j = 0; j < size; j++)
+            if (dimacsLiteral(a, i, j) != dimacsLiteral(b, i, j)) return false;
+    }
+    return true;
+}
 
-        clock_t start = clock();
+// Test parallel CNF conversion on wide conjunctions: sequential
+// convertToCNF against the work-stealing pool on 1..max_threads workers.
+// Every run must give the same clauses, as many as planCNF predicts.
+void test_parallel_cnf(int max_k, int m, int max_threads) {
+    printf("Testing Parallel CNF Conversion (wide conjunctions, %d cores)\n", availableCores());
+    printf("k,nodes,sequential_sec,clauses,threads,parallel_sec,speedup,tasks,steals,match\n");
+    for (int k = 1024; k <= max_k; k *= 4) {
+        char *formula = malloc((size_t)k * m * 40 + 4);
+        generate_wide_conjunction(formula, k, m);
         Node *tree = buildParseTree(formula);
-        clock_t end = clock();
+        int nodes = countNodes(tree);
 
-        double time_taken = (double)(end - start) / CLOCKS_PER_SEC;
+        CnfPlan *plan = planCNF(tree, LLONG_MAX);
+        long long predicted = plan->distributeClauses;
+        freeCnfPlan(plan);
 
-        // Count nodes (space approx)
-        int node_count = 0;
-        count_nodes(tree, &node_count);
+        double t0 = get_wall_time();
+        Node *cnf = convertToCNF(cloneTree(tree));
+        double sequential_time = get_wall_time() - t0;
+        long clauses, literals;
+        count_cnf_clauses(cnf, &clauses, &literals);
+        freeTree(cnf);
 
-        printf("%d,%.6f,%d\n", n, time_taken, node_count);
+        DIMACSFormula *reference = NULL;
+        for (int threads = 1; threads <= max_threads; threads *= 2) {
+            ParallelCnfStats stats;
+            t0 = get_wall_time();
+            DIMACSFormula *dimacs = parallelConvertToDIMACS(tree, threads, &stats);
+            double parallel_time = get_wall_time() - t0;
+
+            bool match = dimacs->numClauses == clauses && dimacs->numClauses == predicted;
+            if (reference == NULL) reference = dimacs;
+            else {
+                match = match && same_dimacs(reference, dimacs);
+            }
+            printf("%d,%d,%.6f,%ld,%d,%.6f,%.2f,%d,%lld,%s\n", k, nodes, sequential_time, clauses, threads,
+                   parallel_time, sequential_time / parallel_time, stats.tasks, stats.steals, match ? "yes" : "NO");
+            fflush(stdout);
+            if (dimacs != reference) freeDIMACS(dimacs);
+        }
+        freeDIMACS(reference);
         freeTree(tree);
+        free(formula);
     }
 }
 
-// Test CNF conversion
-void test_cnf(int max_n) {
-    printf("Testing CNF Conversion Time and Space\n");
-    printf("n,time_sec,nodes\n");
-    for (int n = 10; n <= max_n; n += 10) {
-        char formula[2000];
-        generate_formula(formula, n);
+// Test the fused converter against the four-pass pipeline (convertToCNF's
+// three rewrites, then treeToDIMACS): time, node allocations, and the
+// same number of clauses and literals
+void test_fused_cnf(int max_k) {
+    const char *shapes[4] = {"wide_conjunction", "or_of_ands", "implies", "nested"};
+    printf("Testing Fused CNF vs Four-Pass Pipeline\n");
+    printf("shape,k,pipeline_sec,pipeline_node_allocs,fused_sec,fused_node_allocs,speedup,clauses,literals,match,"
+           "equivalent\n");
+    for (int s = 0; s < 4; s++) {
+        int limit = s == 1 ? 16 : max_k;
+        for (int k = 4; k <= limit; k *= 4) {
+            char *formula = malloc((size_t)k * 240 + 4);
+            if (s == 0) generate_wide_conjunction(formula, k, 4);
+            else generate_pg_corpus(formula, shapes[s], k);
+            Node *tree = buildParseTree(formula);
+
+            resetNodeStats();
+            double t0 = get_wall_time();
+            Node *cnf = convertToCNF(cloneTree(tree));
+            DIMACSFormula *pipeline = treeToDIMACS(cnf);
+            freeTree(cnf);
+            double pipeline_time = get_wall_time() - t0;
+            long pipeline_allocs = nodeStats.allocations;
+
+            resetNodeStats();
+            t0 = get_wall_time();
+            DIMACSFormula *fused = fusedToDIMACS(tree);
+            double fused_time = get_wall_time() - t0;
+            long fused_allocs = nodeStats.allocations;
+
+            long pipeline_literals = 0, fused_literals = 0;
+            for (int i = 0; i < pipeline->numClauses; i++) pipeline_literals += pipeline->clauses[i].size;
+            for (int i = 0; i < fused->numClauses; i++) fused_literals += fused->clauses[i].size;
+            bool match = pipeline->numClauses == fused->numClauses && pipeline_literals == fused_literals;
+
+            const char *equivalent = "-";
+            if (fused->numVars <= 20) {
+                int varCount = 0;
+                int *vars = collectVariables(tree, &varCount);
+                int *assignment = calloc(varCount + 1, sizeof(int));
+                TruthAssignment values[20];
+                bool ok = true;
+                for (int row = 0; row < (1 << varCount) && ok; row++) {
+                    for (int i = 0; i < varCount; i++) {
+                        values[i].variable = vars[i];
+                        values[i].value = assignment[i + 1] = (row >> i) & 1;
+                    }
+                    ok = evaluateDIMACS(fused, assignment) == (evaluateFormula(tree, values, varCount) == 1);
+                }
+                equivalent = ok ? "yes" : "NO";
+                free(assignment);
+                free(vars);
+            }
 
-        Node *tree = buildParseTree(formula);
+            printf("%s,%d,%.6f,%ld,%.6f,%ld,%.2f,%d,%ld,%s,%s\n", shapes[s], k, pipeline_time, pipeline_allocs,
+                   fused_time, fused_allocs, pipeline_time / fused_time, fused->numClauses, fused_literals,
+                   match ? "yes" : "NO", equivalent);
+            fflush(stdout);
+            freeDIMACS(pipeline);
+            freeDIMACS(fused);
+            freeTree(tree);
+            free(formula);
+        }
+    }
+}
 
-        clock_t start = clock();
-        Node *cnf = convertToCNF(cloneTree(tree));
-        clock_t end = clock();
+// Generate a CNF of k clauses, each OR-ing w distinct variables; with
+// tautological set every clause also holds the complement of its last
+// variable, the worst case for a pairwise search: (x1_1+...+x1_w+~x1_w)*...
+void generate_cnf_clauses(char *formula, int k, int w, bool tautological) {
+    int pos = 0;
+    for (int i = 1; i <= k; i++) {
+        if (i > 1) formula[pos++] = '*';
+        formula[pos++] = '(';
+        for (int j = 1; j <= w; j++) {
+            if (j > 1) formula[pos++] = '+';
+            pos += sprintf(formula + pos, "x%d_%d", i, j);
+        }
+        if (tautological) pos += sprintf(formula + pos, "+~x%d_%d", i, w);
+        formula[pos++] = ')';
+    }
+    formula[pos] = '\0';
+}
 
-        double time_taken = (double)(end - start) / CLOCKS_PER_SEC;
+// The validity check as it used to be: remap the variables and compare
+// every pair of literals in each clause
+bool is_valid_cnf_pairwise(Node *cnfRoot) {
+    int numClauses = countClauses(cnfRoot);
+    Node **clauses = malloc(numClauses * sizeof(Node *));
+    int clauseCount = 0;
+    extractClauses(cnfRoot, clauses, &clauseCount, numClauses);
+    bool valid = clauseCount > 0;
+    for (int i = 0; i < clauseCount && valid; i++) {
+        int *literals = malloc(countNodes(clauses[i]) * sizeof(int));
+        int litCount = 0;
+        resetVarMapping();
+        extractLiterals(clauses[i], literals, &litCount);
+        bool clauseValid = false;
+        for (int j = 0; j < litCount && !clauseValid; j++)
+            for (int l = 0; l < litCount; l++)
+                if (j != l && literals[j] == -literals[l]) { clauseValid = true; break; }
+        free(literals);
+        valid = clauseValid;
+    }
+    free(clauses);
+    return valid;
+}
 
-        int node_count = 0;
-        count_nodes(cnf, &node_count);
+// Test the validity check on wide CNFs: the pairwise check against the
+// stamped single pass, sequential and on 1..max_threads threads. The
+// valid rows scan every clause; the invalid rows put a non-tautology
+// first, so the checkers should stop right away.
+void test_valid_cnf(int max_k, int max_threads) {
+    int widths[3] = {8, 64, 512};
+    printf("Testing CNF Validity Check (%d cores)\n", availableCores());
+    printf("k,width,valid,pairwise_sec,stamped_sec,speedup,threads,parallel_sec,match\n");
+    for (int wi = 0; wi < 3; wi++) {
+        int w = widths[wi];
+        for (int k = 256; k <= max_k; k *= 4) {
+            if ((long)k * w > (1L << 22)) break;
+            for (int valid = 1; valid >= 0; valid--) {
+                char *formula = malloc((size_t)k * (w + 1) * 24 + 4);
+                generate_cnf_clauses(formula, k, w, true);
+                if (!valid) {
+                    // Drop the complement from the first clause
+                    char *end = strchr(formula, ')');
+                    char *neg = end;
+                    while (*neg != '+') neg--;
+                    memmove(neg, end, strlen(end) + 1);
+                }
+                Node *cnf = buildParseTree(formula);
+
+                double t0 = get_wall_time();
+                bool pairwise = is_valid_cnf_pairwise(cnf);
+                double pairwise_time = get_wall_time() - t0;
+
+                t0 = get_wall_time();
+                bool stamped = isValidCNF(cnf);
+                double stamped_time = get_wall_time() - t0;
+
+                for (int threads = 1; threads <= max_threads; threads *= 2) {
+                    t0 = get_wall_time();
+                    int first = findNonTautologicalClause(cnf, threads);
+                    double parallel_time = get_wall_time() - t0;
+                    bool match = pairwise == (valid == 1) && stamped == pairwise &&
+                                 first == (valid ? -1 : 0);
+                    printf("%d,%d,%s,%.6f,%.6f,%.2f,%d,%.6f,%s\n", k, w, valid ? "yes" : "no", pairwise_time,
+                           stamped_time, pairwise_time / stamped_time, threads, parallel_time, match ? "yes" : "NO");
+                    fflush(stdout);
+                }
+                freeTree(cnf);
+                free(formula);
+            }
+        }
+    }
+}
 
-        printf("%d,%.6f,%d\n", n, time_taken, node_count);
-        freeTree(tree);
-        freeTree(cnf);
+// The DIMACS reader as it used to be: fgets into a 1024-byte line, strtok
+// and atoi, at most 100 literals per clause and one malloc per clause
+DIMACSFormula *read_dimacs_legacy(const char *filename) {
+    FILE *file = fopen(filename, "r");
+    if (file == NULL) return NULL;
+    DIMACSFormula *formula = createDIMACS(DIMACS_CLAUSE_LIST);
+    char line[1024];
+    while (fgets(line, sizeof(line), file)) {
+        if (line[0] == 'p') {
+            sscanf(line, "p cnf %d %d", &formula->numVars, &formula->numClauses);
+            formula->clauses = malloc(formula->numClauses * sizeof(Clause));
+            break;
+        }
+    }
+    int clauseIndex = 0;
+    while (fgets(line, sizeof(line), file) && clauseIndex < formula->numClauses) {
+        if (line[0] == 'c' || line[0] == '%' || line[0] == '0') continue;
+        int literals[100], litCount = 0;
+        for (char *token = strtok(line, " \t\n"); token != NULL; token = strtok(NULL, " \t\n")) {
+            int lit = atoi(token);
+            if (lit == 0) break;
+            literals[litCount++] = lit;
+        }
+        if (litCount > 0) {
+            formula->clauses[clauseIndex].literals = malloc(litCount * sizeof(int));
+            memcpy(formula->clauses[clauseIndex].literals, literals, litCount * sizeof(int));
+            formula->clauses[clauseIndex++].size = litCount;
+        }
     }
+    formula->numClauses = clauseIndex;
+    fclose(file);
+    return formula;
 }
 
-// Test evaluation (single assignment)
-void test_evaluation(int max_n) {
-    printf("Testing Evaluation Time\n");
-    printf("n,time_sec\n");
-    for (int n = 10; n <= max_n; n += 10) {
-        char formula[2000];
-        generate_formula(formula, n);
+// Build a random CNF of the given number of clauses, each of width
+// literals over numVars variables, and write it to filename with at most
+// perLine literals per line, so wide clauses span lines. Returns the
+// formula that was written.
+DIMACSFormula *write_random_dimacs(const char *filename, int numClauses, int width, int numVars, int perLine) {
+    DIMACSFormula *formula = createDIMACS(DIMACS_CLAUSE_LIST);
+    formula->numVars = numVars;
+    formula->numClauses = numClauses;
+    formula->clauses = malloc(numClauses * sizeof(Clause));
+    formula->literals = malloc((size_t)numClauses * width * sizeof(int));
+    FILE *file = fopen(filename, "w");
+    fprintf(file, "c random %d-literal clauses\np cnf %d %d\n", width, numVars, numClauses);
+    for (int i = 0; i < numClauses; i++) {
+        Clause *clause = &formula->clauses[i];
+        clause->literals = formula->literals + (size_t)i * width;
+        clause->size = width;
+        for (int j = 0; j < width; j++) {
+            int var = 1 + rand() % numVars;
+            clause->literals[j] = rand() & 1 ? var : -var;
+            fprintf(file, "%d%c", clause->literals[j], (j + 1) % perLine == 0 ? '\n' : ' ');
+        }
+        fprintf(file, "0\n");
+    }
+    fclose(file);
+    return formula;
+}
 
-        Node *tree = buildParseTree(formula);
-        char vars[26];
-        int varCount = 0;
-        collectVariables(tree, vars, &varCount);
+// Test the mapped DIMACS reader against the fgets/strtok one on random
+// 3-SAT files of growing size, and on 1000-literal clauses spread over
+// many lines, which the old reader cannot hold. Throughput is in GB/s of
+// file text; every file must read back exactly as written.
+void test_dimacs_reader(int max_mb) {
+    const char *path = "/tmp/test_dimacs_reader.cnf";
+    printf("Testing DIMACS Reader (mmap scanner vs fgets/strtok)\n");
+    printf("shape,clauses,file_mb,legacy_sec,legacy_gbps,mapped_sec,mapped_gbps,speedup,match\n");
+    srand(23);
+    for (int shape = 0; shape < 2; shape++) {
+        int width = shape == 0 ? 3 : 1000;
+        for (int mb = 1; mb <= max_mb; mb *= 4) {
+            // About 25 bytes per 3-SAT clause, 7 per literal of a wide one
+            int numClauses = shape == 0 ? mb * 40000 : mb * 135;
+            int numVars = shape == 0 ? numClauses / 4 : 1000000;
+            DIMACSFormula *written = write_random_dimacs(path, numClauses, width, numVars, 20);
+            struct stat info;
+            stat(path, &info);
+            double gb = info.st_size / 1e9;
+
+            double legacy_time = -1;
+            bool legacy_match = true;
+            if (width <= 100) {
+                double t0 = get_wall_time();
+                DIMACSFormula *legacy = read_dimacs_legacy(path);
+                legacy_time = get_wall_time() - t0;
+                legacy_match = same_dimacs(written, legacy);
+                freeDIMACS(legacy);
+            }
 
-        TruthAssignment assignments[26];
-        for (int i = 0; i < varCount; i++) {
-            assignments[i].variable = vars[i];
-            assignments[i].value = 1; // fixed
+            double t0 = get_wall_time();
+            DIMACSFormula *mapped = readDIMACS(path);
+            double mapped_time = get_wall_time() - t0;
+            bool match = legacy_match && mapped != NULL && same_dimacs(written, mapped);
+
+            if (legacy_time < 0)
+                printf("%s,%d,%.1f,-,-,%.6f,%.3f,-,%s\n", shape == 0 ? "3sat" : "wide", numClauses, gb * 1000,
+                       mapped_time, gb / mapped_time, match ? "yes" : "NO");
+            else
+                printf("%s,%d,%.1f,%.6f,%.3f,%.6f,%.3f,%.2f,%s\n", shape == 0 ? "3sat" : "wide", numClauses,
+                       gb * 1000, legacy_time, gb / legacy_time, mapped_time, gb / mapped_time,
+                       legacy_time / mapped_time, match ? "yes" : "NO");
+            fflush(stdout);
+            freeDIMACS(mapped);
+            freeDIMACS(written);
         }
+    }
+    remove(path);
+}
 
-        clock_t start = clock();
-        int result = evaluateFormula(tree, assignments, varCount);
-        clock_t end = clock();
+// Build a random CNF in the clause list layout, one malloc per clause as
+// the encoders make them. Each clause holds a literal that the planted
+// assignment makes true, so evaluating it scans every clause.
+DIMACSFormula *random_clause_list(int numClauses, int width, int numVars, const int *planted) {
+    DIMACSFormula *formula = createDIMACS(DIMACS_CLAUSE_LIST);
+    formula->numVars = numVars;
+    formula->numClauses = numClauses;
+    formula->clauses = malloc(numClauses * sizeof(Clause));
+    for (int i = 0; i < numClauses; i++) {
+        Clause *clause = &formula->clauses[i];
+        clause->literals = malloc(width * sizeof(int));
+        clause->size = width;
+        for (int j = 0; j < width; j++) {
+            int var = 1 + rand() % numVars;
+            // Only the last literal agrees with the planted assignment
+            bool positive = j == width - 1 ? planted[var] : !planted[var];
+            clause->literals[j] = positive ? var : -var;
+        }
+    }
+    return formula;
+}
 
-        double time_taken = (double)(end - start) / CLOCKS_PER_SEC;
+// Test the flat and packed layouts against the clause list: bytes per
+// clause, time to evaluate the whole formula and to free it, and the
+// same literals through treeToDIMACSAs and a save/readDIMACSAs round trip
+void test_dimacs_layout(int max_clauses) {
+    const char *names[3] = {"clause_list", "flat", "flat_packed"};
+    const char *path = "/tmp/test_dimacs_layout.cnf";
+    printf("Testing DIMACS Layouts (clause list vs flat CSR)\n");
+    printf("clauses,layout,bytes_per_clause,eval_sec,eval_speedup,free_sec,match\n");
+    for (int n = 1 << 14; n <= max_clauses; n *= 4) {
+        int numVars = n / 4;
+        int *planted = malloc((numVars + 1) * sizeof(int));
+        for (int v = 1; v <= numVars; v++) planted[v] = rand() & 1;
+
+        DIMACSFormula *formulas[3];
+        for (int layout = 0; layout < 3; layout++) {
+            srand(n);
+            formulas[layout] = random_clause_list(n, 3, numVars, planted);
+            flattenDIMACS(formulas[layout], layout);
+        }
 
-        printf("%d,%.6f\n", n, time_taken);
-        freeTree(tree);
+        bool matches[3];
+        for (int layout = 0; layout < 3; layout++) matches[layout] = same_dimacs(formulas[0], formulas[layout]);
+
+        double eval_time[3];
+        int repeats = (1 << 24) / n;
+        for (int layout = 0; layout < 3; layout++) {
+            bool match = matches[layout];
+            double t0 = get_wall_time();
+            for (int r = 0; r < repeats; r++) {
+                planted[0] = r; // Unused slot; keeps the compiler from calling once
+                match = evaluateDIMACS(formulas[layout], planted) && match;
+            }
+            eval_time[layout] = (get_wall_time() - t0) / repeats;
+
+            double bytes = (double)dimacsBytes(formulas[layout]) / n;
+            t0 = get_wall_time();
+            freeDIMACS(formulas[layout]);
+            double free_time = get_wall_time() - t0;
+            printf("%d,%s,%.1f,%.6f,%.2f,%.6f,%s\n", n, names[layout], bytes, eval_time[layout],
+                   eval_time[0] / eval_time[layout], free_time, match ? "yes" : "NO");
+            fflush(stdout);
+        }
+        free(planted);
     }
-}
 
-// Test truth table (exponential)
-void test_truth_table(int max_k) {
-    printf("Testing Truth Table Time\n");
-    printf("k,time_sec\n");
-    for (int k = 1; k <= max_k; k++) {
-        // Generate formula with k variables
-        char formula[200];
-        strcpy(formula, "(");
-        for (int i = 0; i < k; i++) {
-            char var = 'a' + i;
-            if (i > 0) strcat(formula, "+");
-            strncat(formula, &var, 1);
+    // Every layout holds the same clauses, from a tree or from a file
+    char *formula = malloc(256 * 9 * 24 + 4);
+    generate_cnf_clauses(formula, 256, 8, true);
+    Node *cnf = buildParseTree(formula);
+    DIMACSFormula *reference = treeToDIMACS(cnf);
+    bool match = true;
+    for (int layout = 0; layout < 3; layout++) {
+        DIMACSFormula *converted = treeToDIMACSAs(cnf, layout);
+        match = match && same_dimacs(reference, converted);
+        saveDIMACS(converted, path);
+        for (int readLayout = 0; readLayout < 3; readLayout++) {
+            DIMACSFormula *loaded = readDIMACSAs(path, readLayout);
+            match = match && loaded != NULL && same_dimacs(reference, loaded);
+            freeDIMACS(loaded);
         }
-        strcat(formula, ")");
+        freeDIMACS(converted);
+    }
+    printf("tree and file round trips across layouts: %s\n", match ? "yes" : "NO");
+    remove(path);
+    freeDIMACS(reference);
+    freeTree(cnf);
+    free(formula);
+}
 
-        Node *tree = buildParseTree(formula);
-        char vars[26];
-        int varCount = 0;
-        collectVariables(tree, vars, &varCount);
+// Hash of everything a flat formula holds, to compare formulas too big
+// to keep two of
+uint64_t hash_flat_dimacs(DIMACSFormula *formula) {
+    uint64_t h = 1469598103934665603ULL ^ formula->numVars ^ ((uint64_t)formula->numClauses << 32);
+    size_t numLiterals = formula->clauseStart[formula->numClauses];
+    for (size_t k = 0; k < numLiterals; k++) h = (h ^ (uint32_t)formula->literals[k]) * 1099511628211ULL;
+    for (int i = 0; i <= formula->numClauses; i++) h = (h ^ formula->clauseStart[i]) * 1099511628211ULL;
+    return h;
+}
 
-        clock_t start = clock();
-        int total = 1 << k;
-        for (int a = 0; a < total; a++) {
-            TruthAssignment assignments[26];
-            for (int i = 0; i < k; i++) {
-                assignments[i].variable = vars[i];
-                assignments[i].value = (a >> i) & 1;
-            }
-            evaluateFormula(tree, assignments, k);
+// Write copies of a DIMACS file's clauses back to back under one header
+// declaring all of them. Returns the size written, or 0 when the file
+// cannot be read.
+long write_replicated_dimacs(const char *source, const char *path, int copies) {
+    FILE *in = fopen(source, "r");
+    if (in == NULL) return 0;
+    int numVars = 0, numClauses = 0;
+    char line[1024];
+    long bodyStart = 0;
+    while (fgets(line, sizeof(line), in)) {
+        if (sscanf(line, "p cnf %d %d", &numVars, &numClauses) == 2) {
+            bodyStart = ftell(in);
+            break;
         }
-        clock_t end = clock();
+    }
+    fseek(in, 0, SEEK_END);
+    long bodySize = ftell(in) - bodyStart;
+    char *body = malloc(bodySize);
+    fseek(in, bodyStart, SEEK_SET);
+    bodySize = fread(body, 1, bodySize, in);
+    fclose(in);
+
+    FILE *out = fopen(path, "w");
+    fprintf(out, "c %d copies of %s\np cnf %d %lld\n", copies, source, numVars, (long long)numClauses * copies);
+    for (int i = 0; i < copies; i++) fwrite(body, 1, bodySize, out);
+    long size = ftell(out);
+    fclose(out);
+    free(body);
+    return size;
+}
 
-        double time_taken = (double)(end - start) / CLOCKS_PER_SEC;
+// Test the parallel DIMACS reader on DIMACSfile1.cnf replicated up to
+// max_mb: sequential readDIMACSAs against readDIMACSParallel on 1 to
+// max_threads threads. Every parallel read must equal the sequential one.
+void test_parallel_dimacs(int max_mb, int max_threads) {
+    const char *path = "/tmp/test_parallel_dimacs.cnf";
+    printf("Testing Parallel DIMACS Reader (DIMACSfile1.cnf replicated, %d cores)\n", availableCores());
+    printf("file_mb,clauses,sequential_sec,sequential_gbps,threads,parallel_sec,parallel_gbps,speedup,identical\n");
+    for (int mb = 16; mb <= max_mb; mb *= 4) {
+        long size = write_replicated_dimacs("DIMACSfile1.cnf", path, mb * 1000000 / 10000);
+        if (size == 0) {
+            printf("DIMACSfile1.cnf not found; run from the repository root\n");
+            return;
+        }
+        double gb = size / 1e9;
+
+        double t0 = get_wall_time();
+        DIMACSFormula *sequential = readDIMACSAs(path, DIMACS_FLAT);
+        double sequential_time = get_wall_time() - t0;
+        int numClauses = sequential->numClauses;
+        uint64_t hash = hash_flat_dimacs(sequential);
+        // Small enough to keep both and compare every literal
+        if (size > 64 * 1000000L) {
+            freeDIMACS(sequential);
+            sequential = NULL;
+        }
 
-        printf("%d,%.6f\n", k, time_taken);
-        freeTree(tree);
+        for (int threads = 1; threads <= max_threads; threads *= 2) {
+            t0 = get_wall_time();
+            DIMACSFormula *parallel = readDIMACSParallel(path, DIMACS_FLAT, threads);
+            double parallel_time = get_wall_time() - t0;
+            bool identical = parallel != NULL && hash_flat_dimacs(parallel) == hash &&
+                             (sequential == NULL || same_dimacs(sequential, parallel));
+            printf("%.0f,%d,%.6f,%.3f,%d,%.6f,%.3f,%.2f,%s\n", gb * 1000, numClauses, sequential_time,
+                   gb / sequential_time, threads, parallel_time, gb / parallel_time, sequential_time / parallel_time,
+                   identical ? "yes" : "NO");
+            fflush(stdout);
+            freeDIMACS(parallel);
+        }
+        freeDIMACS(sequential);
     }
+    remove(path);
 }
 
-int main() {
+int main(int argc, char **argv) {
     int max_n = 1000; // Increased for measurable times
+    int max_parse_n = 10000000;
     int max_k = 26;   // Increased for exponential growth
 
-    test_parsing(max_n);
-    printf("\n");
-    test_cnf(max_n);
-    printf("\n");
-    test_evaluation(max_n);
-    printf("\n");
-    test_truth_table(max_k);
+    // Optional argument selects a single benchmark, e.g. ./test_complexity parsing
+    const char *only = argc > 1 ? argv[1] : NULL;
+
+    if (!only || strcmp(only, "parsing") == 0) {
+        test_parsing(max_parse_n);
+        printf("\n");
+    }
+    if (!only || strcmp(only, "batch_parsing") == 0) {
+        test_batch_parsing(10000, 1000, 16);
+        printf("\n");
+    }
+    if (!only || strcmp(only, "deep_nesting") == 0) {
+        test_deep_nesting(10000000);
+        printf("\n");
+    }
+    if (!only || strcmp(only, "cnf") == 0) {
+        test_cnf(max_n);
+        printf("\n");
+    }
+    if (!only || strcmp(only, "hash_consing") == 0) {
+        test_hash_consing(13);
+        printf("\n");
+    }
+    if (!only || strcmp(only, "flat_tree") == 0) {
+        test_flat_tree(1000000);
+        printf("\n");
+    }
+    if (!only || strcmp(only, "nary") == 0) {
+        test_nary(16384);
+        printf("\n");
+    }
+    if (!only || strcmp(only, "symbols") == 0) {
+        test_symbols(1000000);
+        printf("\n");
+    }
+    if (!only || strcmp(only, "evaluation") == 0) {
+        test_evaluation(max_n);
+        printf("\n");
+    }
+    if (!only || strcmp(only, "truth_table") == 0) {
+        test_truth_table(max_k);
+        printf("\n");
+    }
+    if (!only || strcmp(only, "bytecode") == 0) {
+        test_bytecode(1024);
+        printf("\n");
+    }
+    if (!only || strcmp(only, "simd") == 0) {
+        test_simd(26);
+        printf("\n");
+    }
+    if (!only || strcmp(only, "parallel_truth_table") == 0) {
+        int cores = availableCores();
+        test_parallel_truth_table(26, cores < 8 ? 8 : cores);
+        printf("\n");
+    }
+    if (!only || strcmp(only, "gray_code") == 0) {
+        test_gray_code(16, 4096);
+        printf("\n");
+    }
+    if (!only || strcmp(only, "cofactor") == 0) {
+        test_cofactor(26);
+        printf("\n");
+    }
+    if (!only || strcmp(only, "table_output") == 0) {
+        test_table_output(20);
+        printf("\n");
+    }
+    if (!only || strcmp(only, "tseitin") == 0) {
+        test_tseitin(1 << 20, 14);
+        printf("\n");
+    }
+    if (!only || strcmp(only, "plaisted_greenbaum") == 0) {
+        test_plaisted_greenbaum(1 << 18);
+        printf("\n");
+    }
+    if (!only || strcmp(only, "clause_set") == 0) {
+        test_clause_set(16, 12);
+        printf("\n");
+    }
+    if (!only || strcmp(only, "cnf_planner") == 0) {
+        test_cnf_planner(1 << 16);
+        printf("\n");
+    }
+    if (!only || strcmp(only, "parallel_cnf") == 0) {
+        int cores = availableCores();
+        test_parallel_cnf(1 << 16, 6, cores < 8 ? 8 : cores);
+        printf("\n");
+    }
+    if (!only || strcmp(only, "fused_cnf") == 0) {
+        test_fused_cnf(1 << 16);
+        printf("\n");
+    }
+    if (!only || strcmp(only, "valid_cnf") == 0) {
+        int cores = availableCores();
+        test_valid_cnf(1 << 16, cores < 8 ? 8 : cores);
+        printf("\n");
+    }
+    if (!only || strcmp(only, "dimacs_reader") == 0) {
+        test_dimacs_reader(256);
+        printf("\n");
+    }
+    if (!only || strcmp(only, "dimacs_layout") == 0) {
+        test_dimacs_layout(1 << 22);
+        printf("\n");
+    }
+    if (!only || strcmp(only, "parallel_dimacs") == 0) {
+        int cores = availableCores();
+        test_parallel_dimacs(1024, cores < 8 ? 8 : cores);
+    }
 
     return 0;
 }